@@ -119,11 +119,11 @@ class BinaryEncoder {
   }
 
   /**
-   * Conversion of vector<bool> to binary data. Considers every element a single bit.
-   * @param data
+   * Pushes all bits of code to the end.
+   * @param code
    */
-  void pushBack(const std::vector<bool> &data) {
-    for (const auto bit : data) { pushBack(bit); }
+  void pushBack(BitCode code) {
+    for (std::size_t i = 0; i < code.size(); ++i) { pushBack(code[i]); }
   }
 
   /**
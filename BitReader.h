@@ -0,0 +1,122 @@
+/**
+ * @name BitReader.h
+ * @brief buffered reader of binary codes from memory
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__BITREADER_H
+#define HUFF_CODEC__BITREADER_H
+
+#include "utils.h"
+#include <cassert>
+#include <cstring>
+#include <span>
+
+namespace pf::kko {
+/**
+ * Reader of MSB first binary data, which refills its 64 bit buffer a whole word at a time.
+ * @details Data past the end of input are read as zeros, so decoders don't have to check for the end of input while
+ * reading a single code. Position may get past size() in that case, which is the way to detect an incomplete code.
+ */
+class BitReader {
+ public:
+  using size_type = std::size_t;
+  using word_type = uint64_t;
+  /**
+   * Maximum amount of bits which can be peeked at once.
+   */
+  constexpr static size_type MAX_PEEK_BITS = 56;
+
+  /**
+   * @param data input data
+   */
+  explicit BitReader(std::span<const uint8_t> data) : BitReader(data, data.size() * 8) {}
+  /**
+   * @param data input data
+   * @param bitSize amount of valid bits in data, padding at the end of data is excluded this way
+   */
+  BitReader(std::span<const uint8_t> data, size_type bitSize) : input(data), bitSize(bitSize) {}
+
+  /**
+   * Look at the following bits without moving in the stream.
+   * @param n amount of bits, from 1 to MAX_PEEK_BITS
+   * @return next n bits, the first one being the most significant
+   */
+  [[nodiscard]] word_type peek(size_type n) {
+    assert(n > 0 && n <= MAX_PEEK_BITS);
+    if (bitCount < n) { refill(); }
+    return buffer >> (WORD_BIT_SIZE - n);
+  }
+
+  /**
+   * Move in the stream.
+   * @param n amount of bits, which were peeked before
+   */
+  void consume(size_type n) {
+    assert(n <= bitCount);
+    buffer <<= n;
+    bitCount -= n;
+    bitPosition += n;
+  }
+
+  /**
+   * Read bits and move in the stream.
+   * @param n amount of bits, from 1 to MAX_PEEK_BITS
+   * @return next n bits, the first one being the most significant
+   */
+  [[nodiscard]] word_type read(size_type n) {
+    const auto result = peek(n);
+    consume(n);
+    return result;
+  }
+
+  [[nodiscard]] bool readBit() { return read(1) != 0; }
+
+  /**
+   * @return amount of bits consumed
+   */
+  [[nodiscard]] size_type position() const { return bitPosition; }
+  /**
+   * @return amount of valid bits in the stream
+   */
+  [[nodiscard]] size_type size() const { return bitSize; }
+  /**
+   * @return true if all valid bits have been consumed
+   */
+  [[nodiscard]] bool isExhausted() const { return bitPosition >= bitSize; }
+  /**
+   * @return true if more bits were consumed than are valid - last read code was incomplete
+   */
+  [[nodiscard]] bool isOverrun() const { return bitPosition > bitSize; }
+
+ private:
+  /**
+   * Fill the buffer so that it contains at least MAX_PEEK_BITS bits.
+   */
+  void refill() {
+    buffer |= loadWord(bytePosition) >> bitCount;
+    bytePosition += (WORD_BIT_SIZE - 1 - bitCount) >> 3;
+    bitCount |= MAX_PEEK_BITS;
+  }
+
+  [[nodiscard]] word_type loadWord(size_type byteIndex) const {
+    auto word = word_type{};
+    if (byteIndex + sizeof(word_type) <= input.size()) {
+      std::memcpy(&word, input.data() + byteIndex, sizeof(word_type));
+    } else if (byteIndex < input.size()) {
+      std::memcpy(&word, input.data() + byteIndex, input.size() - byteIndex);
+    }
+    return toBigEndian(word);
+  }
+
+  constexpr static size_type WORD_BIT_SIZE = sizeof(word_type) * 8;
+  std::span<const uint8_t> input;
+  size_type bitSize;
+  word_type buffer{};
+  size_type bitCount{};
+  size_type bytePosition{};
+  size_type bitPosition{};
+};
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__BITREADER_H
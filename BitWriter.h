@@ -0,0 +1,116 @@
+/**
+ * @name BitWriter.h
+ * @brief word-at-a-time writer of binary codes to memory
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__BITWRITER_H
+#define HUFF_CODEC__BITWRITER_H
+
+#include "ByteSink.h"
+#include "utils.h"
+#include <cassert>
+#include <concepts>
+#include <cstring>
+
+namespace pf::kko {
+/**
+ * Writer of binary codes, which collects bits in a 64 bit accumulator and stores them to memory provided by a sink a
+ * whole word at a time. Bits are stored MSB first, so the output is the same as the output of BinaryEncoder<uint8_t>.
+ * @tparam Sink destination of data
+ */
+template<ByteSink Sink>
+class BitWriter {
+ public:
+  using size_type = std::size_t;
+  using word_type = uint64_t;
+
+  /**
+   * @param sink destination of data, it has to outlive the writer
+   */
+  explicit BitWriter(Sink &sink) : sink(sink) {}
+
+  /**
+   * Push code to the end of the stream, most significant bit first.
+   * @param code bits to be pushed, bits above length have to be zeros
+   * @param length amount of bits to be pushed, 64 at most
+   */
+  void pushBits(word_type code, size_type length) {
+    assert(length <= WORD_BIT_SIZE);
+    assert(length == WORD_BIT_SIZE || (code >> length) == 0);
+    if (length == 0) { return; }
+    if (length < freeBits) {
+      freeBits -= length;
+      accumulator |= code << freeBits;
+      return;
+    }
+    const auto overflow = length - freeBits;
+    accumulator |= code >> overflow;
+    flushWord();
+    freeBits = WORD_BIT_SIZE - overflow;
+    accumulator = overflow == 0 ? 0 : code << freeBits;
+  }
+
+  /**
+   * Push code to the end of the stream.
+   * @param code
+   */
+  void pushBits(BitCode code) { pushBits(code.bits, code.length); }
+
+  /**
+   * Push memory representation of value to the end of the stream.
+   * @param value value to be pushed
+   */
+  template<std::integral T>
+  void pushBytes(const T &value) {
+    const auto rawDataPtr = reinterpret_cast<const uint8_t *>(&value);
+    for (std::size_t i = 0; i < sizeof(T); ++i) { pushBits(rawDataPtr[i], 8); }
+  }
+
+  /**
+   * @return amount of bits pushed
+   */
+  [[nodiscard]] size_type size() const { return flushedBytes * 8 + (WORD_BIT_SIZE - freeBits); }
+
+  /**
+   * @return amount of bits needed to align size to bytes
+   */
+  [[nodiscard]] size_type paddingBits() const { return (8 - size() % 8) % 8; }
+
+  /**
+   * Flush all pending bits to the sink, the last byte is padded with zeros. The writer starts a new stream after this.
+   */
+  void flush() {
+    const auto pendingBytes = (WORD_BIT_SIZE - freeBits + 7) / 8;
+    flushWord();
+    sink.finish(position - sizeof(word_type) + pendingBytes);
+    memory = {};
+    position = 0;
+    flushedBytes = 0;
+    freeBits = WORD_BIT_SIZE;
+  }
+
+ private:
+  void flushWord() {
+    if (memory.size() - position < sizeof(word_type)) {
+      memory = sink.next(position, sizeof(word_type));
+      position = 0;
+    }
+    const auto word = toBigEndian(accumulator);
+    std::memcpy(memory.data() + position, &word, sizeof(word_type));
+    position += sizeof(word_type);
+    flushedBytes += sizeof(word_type);
+    accumulator = 0;
+  }
+
+  constexpr static size_type WORD_BIT_SIZE = sizeof(word_type) * 8;
+  Sink &sink;
+  std::span<uint8_t> memory{};
+  size_type position{};
+  word_type accumulator{};
+  size_type freeBits = WORD_BIT_SIZE;
+  size_type flushedBytes{};
+};
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__BITWRITER_H
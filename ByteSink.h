@@ -0,0 +1,261 @@
+/**
+ * @name ByteSink.h
+ * @brief destinations for encoded binary data
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__BYTESINK_H
+#define HUFF_CODEC__BYTESINK_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <ostream>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace pf::kko {
+/**
+ * Destination of binary data, which provides memory to write to.
+ * @details next(writtenBytes, minSize) commits writtenBytes bytes of previously provided memory and provides memory of
+ * at least minSize bytes. finish(writtenBytes) commits the last bytes.
+ */
+template<typename T>
+concept ByteSink = requires(T sink, std::size_t size) {
+  { sink.next(size, size) }
+  ->std::same_as<std::span<uint8_t>>;
+  {sink.finish(size)};
+};
+
+/**
+ * Sink whose next() provides memory of any requested size at once, so that data of known size can be written to it in
+ * place from multiple threads.
+ */
+template<typename T>
+concept ContiguousByteSink = ByteSink<T> && T::IS_CONTIGUOUS;
+
+/**
+ * Sink which can overwrite a byte it has already committed, so that a header can be filled in after the data following
+ * it are written.
+ * @details canPatch() tells whether the destination allows it, patch(offset, value) overwrites the byte at offset from
+ * the beginning of the sink's data, size() is the amount of committed bytes.
+ */
+template<typename T>
+concept PatchableByteSink = ByteSink<T> && requires(T sink, const T &constSink, std::size_t offset, uint8_t value) {
+  { constSink.canPatch() }
+  ->std::same_as<bool>;
+  { constSink.size() }
+  ->std::same_as<std::size_t>;
+  {sink.patch(offset, value)};
+};
+
+/**
+ * Sink storing all data in memory.
+ */
+class VectorSink {
+ public:
+  using size_type = std::size_t;
+  constexpr static bool IS_CONTIGUOUS = true;
+  VectorSink() = default;
+  /**
+   * @param capacity expected size of data in bytes, memory is allocated up front
+   */
+  explicit VectorSink(size_type capacity) { buffer.resize(capacity); }
+  /**
+   * Append data to a caller provided buffer - content of the buffer is kept and its memory is reused.
+   * @param initBuffer buffer, which can be moved out via releaseData()
+   */
+  explicit VectorSink(std::vector<uint8_t> &&initBuffer) : size_(initBuffer.size()), buffer(std::move(initBuffer)) {
+    buffer.resize(buffer.capacity());
+  }
+
+  [[nodiscard]] std::span<uint8_t> next(size_type writtenBytes, size_type minSize) {
+    size_ += writtenBytes;
+    if (buffer.size() - size_ < minSize) {
+      buffer.resize(std::max({buffer.size() * 2, size_ + minSize, MIN_CAPACITY}));
+    }
+    return {buffer.data() + size_, buffer.size() - size_};
+  }
+
+  void finish(size_type writtenBytes) {
+    size_ += writtenBytes;
+    buffer.resize(size_);
+  }
+
+  /**
+   * @return amount of committed bytes
+   */
+  [[nodiscard]] size_type size() const { return size_; }
+
+  [[nodiscard]] bool canPatch() const { return true; }
+  void patch(size_type offset, uint8_t value) {
+    assert(offset < size_);
+    buffer[offset] = value;
+  }
+
+  /**
+   * Move data out of the object.
+   * @return vector of binary data
+   */
+  [[nodiscard]] std::vector<uint8_t> releaseData() {
+    buffer.resize(size_);
+    size_ = 0;
+    return std::move(buffer);
+  }
+
+ private:
+  constexpr static size_type MIN_CAPACITY = 4096;
+  size_type size_{};
+  std::vector<uint8_t> buffer{};
+};
+
+/**
+ * Sink writing data to a stream in chunks of fixed size, so that memory use doesn't depend on size of data.
+ */
+class StreamSink {
+ public:
+  using size_type = std::size_t;
+  constexpr static size_type DEFAULT_CHUNK_SIZE = 1024 * 1024;
+  /**
+   * @param ostream output stream
+   * @param chunkSize size of chunks written to stream
+   */
+  explicit StreamSink(std::ostream &ostream, size_type chunkSize = DEFAULT_CHUNK_SIZE)
+      : output(ostream), chunk(chunkSize), startPosition(ostream.tellp()) {}
+
+  [[nodiscard]] std::span<uint8_t> next(size_type writtenBytes, [[maybe_unused]] size_type minSize) {
+    assert(minSize <= chunk.size());
+    write(writtenBytes);
+    return chunk;
+  }
+
+  void finish(size_type writtenBytes) {
+    write(writtenBytes);
+    output.flush();
+  }
+
+  /**
+   * @return amount of bytes written to stream
+   */
+  [[nodiscard]] size_type size() const { return size_; }
+
+  /**
+   * @return false when the stream isn't seekable, e.g. a pipe
+   */
+  [[nodiscard]] bool canPatch() const { return startPosition != std::ostream::pos_type(-1); }
+  void patch(size_type offset, uint8_t value) {
+    assert(canPatch() && offset < size_);
+    const auto endPosition = output.tellp();
+    output.seekp(startPosition + static_cast<std::ostream::off_type>(offset));
+    output.put(static_cast<char>(value));
+    output.seekp(endPosition);
+  }
+
+ private:
+  void write(size_type byteCount) {
+    output.write(reinterpret_cast<const char *>(chunk.data()), static_cast<std::streamsize>(byteCount));
+    size_ += byteCount;
+  }
+
+  std::ostream &output;
+  std::vector<uint8_t> chunk;
+  std::ostream::pos_type startPosition;
+  size_type size_{};
+};
+
+/**
+ * Sink writing data to caller owned memory of fixed size.
+ * @details std::length_error is thrown when the memory is not large enough for the data.
+ */
+class SpanSink {
+ public:
+  using size_type = std::size_t;
+  constexpr static bool IS_CONTIGUOUS = true;
+  /**
+   * @param memory destination of data, it has to outlive the sink
+   */
+  explicit SpanSink(std::span<uint8_t> memory) : output(memory) {}
+
+  [[nodiscard]] std::span<uint8_t> next(size_type writtenBytes, size_type minSize) {
+    commit(writtenBytes);
+    if (output.size() - size_ >= minSize) {
+      isTailUsed = false;
+      return output.subspan(size_);
+    }
+    if (minSize > tail.size()) { throw std::length_error("Output memory is too small"); }
+    // the rest of the memory is too small, data are written to the tail buffer and copied on commit
+    isTailUsed = true;
+    return tail;
+  }
+
+  void finish(size_type writtenBytes) {
+    commit(writtenBytes);
+    isTailUsed = false;
+  }
+
+  /**
+   * @return amount of bytes written to memory
+   */
+  [[nodiscard]] size_type size() const { return size_; }
+
+  [[nodiscard]] bool canPatch() const { return true; }
+  void patch(size_type offset, uint8_t value) {
+    assert(offset < size_);
+    output[offset] = value;
+  }
+
+ private:
+  void commit(size_type byteCount) {
+    if (isTailUsed) {
+      if (output.size() - size_ < byteCount) { throw std::length_error("Output memory is too small"); }
+      std::copy_n(tail.begin(), byteCount, output.begin() + size_);
+    }
+    size_ += byteCount;
+  }
+
+  std::span<uint8_t> output;
+  size_type size_{};
+  std::array<uint8_t, 64> tail{};
+  bool isTailUsed = false;
+};
+
+/**
+ * Copy whole byte buffers to sink one after another and finish it.
+ * @param sink destination of data
+ * @param parts contiguous ranges of bytes
+ */
+void writeToSink(ByteSink auto &sink, const std::ranges::forward_range auto &parts) {
+  auto writtenBytes = std::size_t{};
+  auto memory = std::span<uint8_t>{};
+  for (const auto &part : parts) {
+    for (auto remaining = std::span<const uint8_t>{std::ranges::data(part), std::ranges::size(part)};
+         !remaining.empty();) {
+      if (memory.size() == writtenBytes) {
+        memory = sink.next(writtenBytes, 1);
+        writtenBytes = 0;
+      }
+      const auto count = std::min(memory.size() - writtenBytes, remaining.size());
+      std::ranges::copy(remaining.first(count), memory.begin() + static_cast<std::ptrdiff_t>(writtenBytes));
+      writtenBytes += count;
+      remaining = remaining.subspan(count);
+    }
+  }
+  sink.finish(writtenBytes);
+}
+
+static_assert(ByteSink<VectorSink>);
+static_assert(ByteSink<StreamSink>);
+static_assert(ByteSink<SpanSink>);
+static_assert(ContiguousByteSink<VectorSink>);
+static_assert(ContiguousByteSink<SpanSink>);
+static_assert(!ContiguousByteSink<StreamSink>);
+static_assert(PatchableByteSink<VectorSink>);
+static_assert(PatchableByteSink<StreamSink>);
+static_assert(PatchableByteSink<SpanSink>);
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__BYTESINK_H
@@ -0,0 +1,229 @@
+/**
+ * @name DecodingTable.h
+ * @brief lookup tables for decoding of canonical huffman codes
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__DECODINGTABLE_H
+#define HUFF_CODEC__DECODINGTABLE_H
+
+#include "BitReader.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+namespace pf::kko {
+/**
+ * Entry of DecodingTable.
+ * @details Entry is either a leaf with a symbol, a link to a sub table or invalid, when both length and subTableBits
+ * are 0.
+ */
+struct DecodingTableEntry {
+  /**
+   * Decoded symbol for leaf, offset of sub table otherwise.
+   */
+  uint32_t value{};
+  /**
+   * Amount of bits of the code in the table which contains this entry.
+   */
+  uint8_t length{};
+  /**
+   * Amount of index bits of sub table, 0 for leaf.
+   */
+  uint8_t subTableBits{};
+
+  [[nodiscard]] bool isLeaf() const { return length != 0; }
+};
+
+/**
+ * Entry of DecodingTable, which decodes multiple short codes at once.
+ * @details Entry with count 0 means, that the first code isn't short enough and it has to be decoded by multi level
+ * lookup.
+ */
+struct MultiSymbolDecodingTableEntry {
+  constexpr static std::size_t MAX_SYMBOLS = 6;
+  std::array<uint8_t, MAX_SYMBOLS> symbols{};
+  /**
+   * Amount of valid symbols.
+   */
+  uint8_t count{};
+  /**
+   * Total length of codes of all symbols.
+   */
+  uint8_t length{};
+};
+
+/**
+ * Multi level lookup table for canonical huffman codes.
+ * @details The primary table is indexed by the next PRIMARY_BITS bits of input. Codes longer than that are resolved
+ * by sub tables, each of them indexed by at most SUB_TABLE_BITS following bits. All tables are stored in a single
+ * vector, primary table being at its start.
+ * Another table indexed by MULTI_SYMBOL_BITS bits decodes all codes which fit into those bits at once, up to
+ * MultiSymbolEntry::MAX_SYMBOLS of them. Small residuals of image models have codes of a few bits, so this table
+ * decodes most of the input several symbols per lookup.
+ */
+class DecodingTable {
+ public:
+  using size_type = std::size_t;
+  using Entry = DecodingTableEntry;
+  using MultiSymbolEntry = MultiSymbolDecodingTableEntry;
+  constexpr static size_type PRIMARY_BITS = 11;
+  constexpr static size_type MULTI_SYMBOL_BITS = 11;
+  constexpr static size_type SUB_TABLE_BITS = 8;
+  /**
+   * Maximum supported code length.
+   */
+  constexpr static size_type MAX_CODE_LENGTH = BitReader::MAX_PEEK_BITS;
+
+  /**
+   * Build table for canonical codes.
+   * @param lengthCounts amount of codes of each length, index 0 being for length 1
+   * @param symbols symbols in canonical order - sorted by code length
+   * @param withMultiSymbolTable build the table for decodeMultiple, building it costs about as much as decoding a few
+   * thousand symbols one at a time
+   * @throws std::invalid_argument when code lengths don't describe a prefix code or they're too long, or when a symbol
+   * doesn't fit into a byte
+   */
+  DecodingTable(std::span<const std::size_t> lengthCounts, std::span<const std::size_t> symbols,
+                bool withMultiSymbolTable = true) {
+    auto codes = std::vector<CanonicalCode>{};
+    auto code = uint64_t{};
+    auto kraftSum = uint64_t{};
+    const auto maxLength = lengthCounts.size();
+    if (maxLength > MAX_CODE_LENGTH) { throw std::invalid_argument("Code length not supported by decoder"); }
+    for (size_type length = 1; length <= maxLength; ++length) {
+      for (size_type i = 0; i < lengthCounts[length - 1]; ++i) {
+        if (codes.size() >= symbols.size()) { throw std::invalid_argument("Code count doesn't match symbol count"); }
+        if (symbols[codes.size()] > UINT8_MAX) { throw std::invalid_argument("Symbol doesn't fit into a byte"); }
+        codes.emplace_back(code++, static_cast<uint8_t>(length), static_cast<uint32_t>(symbols[codes.size()]));
+        kraftSum += uint64_t{1} << (maxLength - length);
+        if (kraftSum > (uint64_t{1} << maxLength)) { throw std::invalid_argument("Code lengths are over-subscribed"); }
+      }
+      code <<= 1;
+    }
+    if (codes.size() != symbols.size()) { throw std::invalid_argument("Code count doesn't match symbol count"); }
+    primaryBits = std::max<size_type>(std::min(maxLength, PRIMARY_BITS), 1);
+    buildTable(codes, 0, primaryBits);
+    if (withMultiSymbolTable) { buildMultiSymbolTable(); }
+  }
+
+  /**
+   * Decode a single symbol.
+   * @details Position of the reader is moved past the code even if it's past the end of valid data.
+   * @param reader source of codes
+   * @param symbol destination of decoded symbol
+   * @return false if the input contains invalid code
+   */
+  template<typename T>
+  [[nodiscard]] bool decode(BitReader &reader, T &symbol) const {
+    auto entry = entries[reader.peek(primaryBits)];
+    auto tableBits = primaryBits;
+    while (!entry.isLeaf()) {
+      if (entry.subTableBits == 0) { return false; }
+      reader.consume(tableBits);
+      tableBits = entry.subTableBits;
+      entry = entries[entry.value + reader.peek(tableBits)];
+    }
+    reader.consume(entry.length);
+    symbol = static_cast<T>(entry.value);
+    return true;
+  }
+
+  /**
+   * Decode as many codes as fit into the next MULTI_SYMBOL_BITS bits, at least one.
+   * @details Table has to be built withMultiSymbolTable. The reader has to contain at least MULTI_SYMBOL_BITS valid
+   * bits, so that no code is decoded from bits past the end of valid data. Position of the reader is moved past the
+   * last code, which may be past the end of valid data only if the code is longer than MULTI_SYMBOL_BITS.
+   * @param reader source of codes
+   * @param output destination of decoded symbols, there has to be space for MultiSymbolEntry::MAX_SYMBOLS of them
+   * @return amount of decoded symbols, 0 if the input contains invalid code
+   */
+  template<typename T>
+  [[nodiscard]] size_type decodeMultiple(BitReader &reader, T *output) const {
+    const auto &entry = multiSymbolEntries[reader.peek(MULTI_SYMBOL_BITS)];
+    if (entry.count == 0) { return decode(reader, *output) ? 1 : 0; }
+    for (size_type i = 0; i < MultiSymbolEntry::MAX_SYMBOLS; ++i) { output[i] = static_cast<T>(entry.symbols[i]); }
+    reader.consume(entry.length);
+    return entry.count;
+  }
+
+  [[nodiscard]] bool hasMultiSymbolTable() const { return !multiSymbolEntries.empty(); }
+  [[nodiscard]] size_type getPrimaryBits() const { return primaryBits; }
+  [[nodiscard]] std::span<const Entry> getEntries() const { return entries; }
+
+ private:
+  struct CanonicalCode {
+    uint64_t bits;
+    uint8_t length;
+    uint32_t symbol;
+  };
+
+  /**
+   * Build a table for codes sharing the same prefix.
+   * @param codes codes with the same prefix sorted in canonical order
+   * @param prefixLength length of the shared prefix
+   * @param tableBits amount of index bits of the table
+   * @return offset of the table in entries
+   */
+  size_type buildTable(std::span<const CanonicalCode> codes, size_type prefixLength, size_type tableBits) {
+    const auto offset = entries.size();
+    entries.resize(offset + (size_type{1} << tableBits));
+    const auto indexMask = (uint64_t{1} << tableBits) - 1;
+    for (size_type i = 0; i < codes.size();) {
+      const auto remainingLength = codes[i].length - prefixLength;
+      if (remainingLength <= tableBits) {
+        const auto fillBits = tableBits - remainingLength;
+        const auto first = (codes[i].bits << fillBits) & indexMask;
+        std::fill_n(entries.begin() + static_cast<std::ptrdiff_t>(offset + first), size_type{1} << fillBits,
+                    Entry{codes[i].symbol, static_cast<uint8_t>(remainingLength), 0});
+        ++i;
+        continue;
+      }
+      // codes sharing an index are next to each other in canonical order, the longest one being the last
+      const auto index = (codes[i].bits >> (remainingLength - tableBits)) & indexMask;
+      auto groupEnd = i + 1;
+      while (groupEnd < codes.size() && codes[groupEnd].length - prefixLength > tableBits
+             && ((codes[groupEnd].bits >> (codes[groupEnd].length - prefixLength - tableBits)) & indexMask) == index) {
+        ++groupEnd;
+      }
+      const auto subTableBits =
+          std::min<size_type>(codes[groupEnd - 1].length - prefixLength - tableBits, SUB_TABLE_BITS);
+      const auto subTableOffset = buildTable(codes.subspan(i, groupEnd - i), prefixLength + tableBits, subTableBits);
+      entries[offset + index] = Entry{static_cast<uint32_t>(subTableOffset), 0, static_cast<uint8_t>(subTableBits)};
+      i = groupEnd;
+    }
+    return offset;
+  }
+
+  /**
+   * Fill multiSymbolEntries by looking up successive codes of each index in the primary table.
+   */
+  void buildMultiSymbolTable() {
+    multiSymbolEntries.resize(size_type{1} << MULTI_SYMBOL_BITS);
+    for (size_type index = 0; index < multiSymbolEntries.size(); ++index) {
+      auto &multiEntry = multiSymbolEntries[index];
+      auto usedBits = size_type{};
+      while (multiEntry.count < MultiSymbolEntry::MAX_SYMBOLS && usedBits < MULTI_SYMBOL_BITS) {
+        const auto remainingBits = MULTI_SYMBOL_BITS - usedBits;
+        // missing bits of a short window are zeros, a code which fits into the window doesn't depend on them
+        const auto window = remainingBits >= primaryBits ? (index >> (remainingBits - primaryBits))
+                                                         : (index << (primaryBits - remainingBits));
+        const auto &entry = entries[window & ((size_type{1} << primaryBits) - 1)];
+        if (!entry.isLeaf() || entry.length > remainingBits) { break; }
+        multiEntry.symbols[multiEntry.count++] = static_cast<uint8_t>(entry.value);
+        usedBits += entry.length;
+      }
+      multiEntry.length = static_cast<uint8_t>(usedBits);
+    }
+  }
+
+  size_type primaryBits;
+  std::vector<Entry> entries;
+  std::vector<MultiSymbolEntry> multiSymbolEntries;
+};
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__DECODINGTABLE_H
@@ -9,6 +9,7 @@
 #define HUFF_CODEC__ADAPTIVE_BLOCKS_DECODING_H
 
 #include "AdaptiveImageScanner.h"
+#include "BitReader.h"
 #include "adaptive_common.h"
 #include <fmt/core.h>
 #include <tl/expected.hpp>
@@ -24,26 +25,21 @@ struct ImageHeader {
   uint8_t blockHeight{};
 };
 
-struct ImageHeaderBuilder {
-  ImageHeader header{};
-  std::size_t bytesRead{};
-  void add(uint8_t byte) {
-    if (bytesRead == 0) { header.width = byte; }
-    if (bytesRead == 1) { header.width |= byte << 8; }
-    if (bytesRead == 2) { header.height = byte; }
-    if (bytesRead == 3) { header.height |= byte << 8; }
-    if (bytesRead == 4) { header.blockWidth = byte; }
-    if (bytesRead == 5) { header.blockHeight = byte; }
-    ++bytesRead;
-  }
-
-  [[nodiscard]] bool isDone() const { return bytesRead == 6; }
-};
-
-struct BlockHeader {
-  ScanMethod scanMethod{};
-  uint8_t bitsRead{};
-};
+/**
+ * Read image header - image size and block size.
+ * @param reader input data
+ * @return header, the result is invalid if the reader is overrun
+ */
+inline ImageHeader readImageHeader(BitReader &reader) {
+  auto header = ImageHeader{};
+  header.width = static_cast<uint16_t>(reader.read(8));
+  header.width |= static_cast<uint16_t>(reader.read(8) << 8);
+  header.height = static_cast<uint16_t>(reader.read(8));
+  header.height |= static_cast<uint16_t>(reader.read(8) << 8);
+  header.blockWidth = static_cast<uint8_t>(reader.read(8));
+  header.blockHeight = static_cast<uint8_t>(reader.read(8));
+  return header;
+}
 
 /**
  * Structure for calculating coordinates of decoded symbols.
@@ -88,141 +84,56 @@ struct BlockScanData {
   }
 };
 
-enum class DecodeState { ImageHeader, BlockHeader, Tree, Value };
-
-template<typename T, Model<T> Model>
-struct DecodeContext {
-  void setHeader(ImageHeader newHeader) {
-    header = newHeader;
-    symbolsInBlock = header.blockHeight * header.blockWidth;
-    blockScanData.imageWidth = header.width;
-    blockScanData.blockSize = {header.blockWidth, header.blockHeight};
-  }
-  ImageHeader header{};
-  BlockHeader blockHeader{};
-  std::size_t symbolsInBlock{};
-  BlockScanData blockScanData{};
-  DecodeState state = DecodeState::ImageHeader;
-
-  uint8_t scanMethodBuffer{};
-  uint16_t symbolCounter{};
-  Model currentlyUsedModel{};
-
-  bool isFirstBlock = true;
-};
+constexpr auto END_OF_BLOCKS = 0b111;
 
 /**
  * decode data encoded using adaptive huffman encoding and adaptive image scanning
  * @param data data encoded using adaptive huffman encoding and adaptive image scanni
  * @param model transformation of neighboring data
+ * @param rescaleThreshold threshold used during encoding, @see detail::AdaptiveTree
  * @return decoded data
  */
 template<std::integral T>
-tl::expected<std::vector<T>, std::string> decodeImageAdaptiveBlocks(std::ranges::forward_range auto &&data,
-                                                                    Model<T> auto &&model) {
-  auto tree = detail::TreeType<T>{};
-  tree.setRoot(makeUniqueNode(makeNYTAdaptive<T>()));
-
-  auto symbolNodes = detail::NodeCacheArray<T>{nullptr};
-
-  auto node = std::make_observer(&tree.getRoot());
-  auto nytNode = node;
-  [[maybe_unused]] const auto resetTree = [&] {
-    std::ranges::fill(symbolNodes, nullptr);
-    tree.setRoot(makeUniqueNode(makeNYTAdaptive<T>()));
-    node = std::make_observer(&tree.getRoot());
-    nytNode = node;
-  };
+tl::expected<std::vector<T>, std::string> decodeImageAdaptiveBlocks(std::ranges::contiguous_range auto &&data,
+                                                                    Model<T> auto &&model,
+                                                                    std::size_t rescaleThreshold = 0) {
+  auto tree = detail::AdaptiveTree<T>{rescaleThreshold};
 
   auto result = std::vector<T>{};
-  auto resultView = View2D<std::vector<T>, false>{};
-
-  auto inspectedCode = std::vector<bool>{};
-  bool done = false;
-
-  auto headerBuilder = ImageHeaderBuilder{};
-  auto ctx = DecodeContext<T, std::decay_t<decltype(model)>>{};
-  std::ranges::for_each(data, [&](const auto byte) {
-    switch (ctx.state) {
-      case DecodeState::ImageHeader:
-        headerBuilder.add(byte);
-        if (headerBuilder.isDone()) {
-          ctx.setHeader(headerBuilder.header);
-          ctx.state = DecodeState::BlockHeader;
-          result.resize(ctx.header.width * ctx.header.height);
-          resultView = makeView2D(result, ctx.header.width);
-        }
-        return;
-      default: break;
+
+  auto reader = BitReader{std::span<const uint8_t>{std::ranges::data(data), std::ranges::size(data)}};
+  const auto header = readImageHeader(reader);
+  if (reader.isOverrun()) { return result; }
+  result.resize(header.width * header.height);
+  auto resultView = makeView2D(result, header.width);
+
+  const auto symbolsInBlock = static_cast<std::size_t>(header.blockWidth) * header.blockHeight;
+  auto blockScanData = BlockScanData{};
+  blockScanData.imageWidth = header.width;
+  blockScanData.blockSize = {header.blockWidth, header.blockHeight};
+
+  while (!reader.isExhausted()) {
+    const auto scanMethod = reader.read(3);
+    if (reader.isOverrun() || scanMethod == END_OF_BLOCKS) { break; }
+    if (!magic_enum::enum_contains<ScanMethod>(static_cast<uint8_t>(scanMethod))) {
+      return tl::make_unexpected(fmt::format("Invalid scan method: {}", scanMethod));
     }
+    blockScanData.reset(static_cast<ScanMethod>(scanMethod));
+    auto currentlyUsedModel = model;
 
-    if (done) { return; }
-    forEachBit(byte, [&](bool bit) {
-      if (done) { return; }
-      switch (ctx.state) {
-        case DecodeState::ImageHeader: throw std::runtime_error("Invalid state");
-        case DecodeState::BlockHeader:
-          ++ctx.blockHeader.bitsRead;
-          ctx.scanMethodBuffer |= ((bit ? 1 : 0) << (3 - ctx.blockHeader.bitsRead));
-          if (ctx.blockHeader.bitsRead == 3) {
-            if (ctx.scanMethodBuffer == 0b111) {
-              done = true;
-              return;
-            }
-            ctx.blockHeader.scanMethod = static_cast<ScanMethod>(ctx.scanMethodBuffer);
-            ctx.blockScanData.reset(ctx.blockHeader.scanMethod);
-            ctx.state = ctx.isFirstBlock ? DecodeState::Value : DecodeState::Tree;
-            //ctx.state = DecodeState::Value;
-            //resetTree();
-            ctx.isFirstBlock = false;
-            ctx.currentlyUsedModel = model;
-            ctx.blockHeader.bitsRead = 0;
-          }
-          return;
-        case DecodeState::Tree: {
-          if (bit) {
-            node = std::make_observer(&node->getRight());
-          } else {
-            node = std::make_observer(&node->getLeft());
-          }
-          break;
-        }
-        case DecodeState::Value: {
-          break;
-        }
-      }
-      auto symbol = std::optional<T>{};
-      if (node->isLeaf() && !(*node)->isNYT) {
-        symbol = (*node)->value;
-      } else if ((*node)->isNYT) {
-        if (ctx.state == DecodeState::Value) { inspectedCode.template emplace_back(bit); }
-        ctx.state = DecodeState::Value;
-        if (inspectedCode.size() == 9) {
-          symbol = binToIntegral<T>(inspectedCode);
-          inspectedCode.clear();
-          ctx.state = DecodeState::Tree;
-        }
-      }
+    for (std::size_t i = 0; i < symbolsInBlock; ++i) {
+      const auto symbol = readAdaptiveSymbol<T>(reader, tree);
+      if (reader.isOverrun()) { return result; }
+      tree.update(symbol);
 
-      if (symbol.has_value()) {
-        nytNode = updateTree(tree, *symbol, nytNode, symbolNodes);
-        node = std::make_observer(&tree.getRoot());
-
-        const auto pos = ctx.blockScanData.getPosInData();
-        if (pos.first < ctx.header.width && pos.second < ctx.header.height) {
-          resultView[pos.first][pos.second] = ctx.currentlyUsedModel.revert(*symbol);
-        }
-        ctx.blockScanData.move();
-        ++ctx.symbolCounter;
-        if (ctx.symbolCounter == ctx.symbolsInBlock) {
-          ctx.symbolCounter = 0;
-          ctx.state = DecodeState::BlockHeader;
-          ctx.scanMethodBuffer = 0;
-          ++ctx.blockScanData.blockIndex;
-        }
+      const auto pos = blockScanData.getPosInData();
+      if (pos.first < header.width && pos.second < header.height) {
+        resultView[pos.first][pos.second] = currentlyUsedModel.revert(symbol);
       }
-    });
-  });
+      blockScanData.move();
+    }
+    ++blockScanData.blockIndex;
+  }
 
   return result;
 }
@@ -9,12 +9,14 @@
 #define HUFF_CODEC__ENCODE_ADAPTIVE_BLOCKS_H
 
 #include "AdaptiveImageScanner.h"
-#include "BinaryEncoder.h"
+#include "BitWriter.h"
 #include "adaptive_common.h"
+#include "adaptive_encoding.h"
 #include "models.h"
 #include "utils.h"
 #include <concepts>
 #include <ranges>
+#include <spdlog/spdlog.h>
 #include <vector>
 
 namespace pf::kko {
@@ -28,52 +30,59 @@ namespace pf::kko {
  * @param data data to be encoded
  * @param imageWidth width of image
  * @param model transformation of neighboring data
- * @return data encoded using adaptive huffman code
+ * @param sink destination of data encoded using adaptive huffman code
+ * @param rescaleThreshold sum of weights at which weights of adaptive tree are halved, 0 to never halve them. The
+ * same threshold has to be used for decoding.
  */
 template<std::integral T>
-std::vector<uint8_t> encodeImageAdaptiveBlocks(std::ranges::forward_range auto &&data, std::size_t imageWidth,
-                                               Model<T> auto &&model) {
+void encodeImageAdaptiveBlocks(std::ranges::forward_range auto &&data, std::size_t imageWidth, Model<T> auto &&model,
+                               ByteSink auto &sink, std::size_t rescaleThreshold = 0) {
   auto view = makeView2D<true>(data, imageWidth);
 
   auto scanner = AdaptiveImageScanner(view, {8, 8}, NeighborDifferenceScorer{}, std::forward<decltype(model)>(model));
 
-  auto symbolNodes = detail::NodeCacheArray<T>{nullptr};
-  auto tree = detail::TreeType<T>{};
-
-  tree.setRoot(makeUniqueNode(makeNYTAdaptive<T>()));
-  auto nytNode = std::make_observer(&tree.getRoot());
+  auto tree = detail::AdaptiveTree<T>{rescaleThreshold};
 
   spdlog::trace("Tree initialised");
 
-  auto binEncoder = BinaryEncoder<uint8_t>{};
+  auto binEncoder = BitWriter{sink};
   const auto imageHeight = view.size();
   // save image info - image size, block size
-  binEncoder.pushBack(static_cast<uint16_t>(imageWidth),
-                      static_cast<uint16_t>(imageHeight));// TODO: check evaluation order on merlin
-  binEncoder.pushBack(
-      static_cast<uint8_t>(scanner.getBlockDimensions().first),
-      static_cast<uint8_t>(scanner.getBlockDimensions().second));// TODO: check evaluation order on merlin
+  binEncoder.pushBytes(static_cast<uint16_t>(imageWidth));
+  binEncoder.pushBytes(static_cast<uint16_t>(imageHeight));
+  binEncoder.pushBytes(static_cast<uint8_t>(scanner.getBlockDimensions().first));
+  binEncoder.pushBytes(static_cast<uint8_t>(scanner.getBlockDimensions().second));
   spdlog::trace("Added header");
 
   for (auto &block : scanner) {
     // save block info (scan method type)
-    binEncoder.pushBack(typeToBits(block.getScanMethod(), 3));
+    binEncoder.pushBits(static_cast<uint8_t>(block.getScanMethod()), 3);
     for (auto symbol : block) {
-      auto code = std::vector<bool>{};
-      if (symbolNodes[symbol] != nullptr) {
-        code = getPathToSymbol<T>(tree.getRoot(), *symbolNodes[symbol]);
+      if (const auto symbolNode = tree.getSymbolNode(symbol); symbolNode != detail::AdaptiveTree<T>::NONE) {
+        binEncoder.pushBits(getPathToSymbol<T>(tree, symbolNode));
       } else {
-        code = getPathToSymbol<T>(tree.getRoot(), *nytNode);
-        std::ranges::copy(typeToBits(symbol, 9), std::back_inserter(code));
+        binEncoder.pushBits(getPathToSymbol<T>(tree, tree.getNYTNode()));
+        binEncoder.pushBits(symbol, 9);
       }
-      binEncoder.pushBack(code);
-      nytNode = updateTree(tree, symbol, nytNode, symbolNodes);
+      tree.update(symbol);
     }
   }
-  binEncoder.pushBack(typeToBits(uint8_t{0b111}, 3));
+  binEncoder.pushBits(0b111, 3);
   spdlog::info("Done, output data size: {}[b]", binEncoder.size());
 
-  return binEncoder.releaseData();
+  binEncoder.flush();
+}
+
+/**
+ * Encoding to memory, @see encodeImageAdaptiveBlocks above.
+ * @return data encoded using adaptive huffman code
+ */
+template<std::integral T>
+std::vector<uint8_t> encodeImageAdaptiveBlocks(std::ranges::forward_range auto &&data, std::size_t imageWidth,
+                                               Model<T> auto &&model, std::size_t rescaleThreshold = 0) {
+  auto sink = VectorSink{};
+  encodeImageAdaptiveBlocks<T>(data, imageWidth, std::forward<decltype(model)>(model), sink, rescaleThreshold);
+  return sink.releaseData();
 }
 
 }// namespace pf::kko
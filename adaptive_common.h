@@ -8,69 +8,253 @@
 #ifndef HUFF_CODEC__ADAPTIVE_COMMON_H
 #define HUFF_CODEC__ADAPTIVE_COMMON_H
 
-#include "EncodingTreeData.h"
-#include "Tree.h"
+#include "BitReader.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 namespace pf::kko {
 
-namespace detail {
-template<std::integral T>
-using NodeType = Node<AdaptiveEncodingTreeData<T>>;
-template<std::integral T>
-using TreeType = Tree<AdaptiveEncodingTreeData<T>>;
-template<std::integral T>
-using NodeCacheArray = std::array<std::observer_ptr<detail::NodeType<T>>, ValueCount<T>>;
-}// namespace detail
-
 template <std::integral T>
 constexpr auto PSEUDO_EOF = ~T{0};
 
+namespace detail {
+/**
+ * Adaptive huffman tree stored in arrays indexed by order of nodes.
+ * @details Orders are positions in the tree. Swapping two nodes exchanges their contents, while the parent of each
+ * position stays the same. Siblings have adjacent orders, so an internal node stores only the order of its left child,
+ * a leaf stores its symbol. The whole tree takes a few KB of contiguous memory.
+ *
+ * Sibling property keeps weights sorted by order, so nodes of equal weight occupy a continuous range of orders - a
+ * block. Each block knows its leader, the node with the highest order in it. A node is swapped with the leader of its
+ * block before its weight is incremented, which moves it from the top of its block to the bottom of the next one.
+ * Blocks are assigned to orders, so swapping nodes doesn't change them.
+ *
+ * Weights of all symbols are halved when they sum up to rescale threshold. That bounds depth of the tree, so that
+ * codes and updates don't get longer on long streams with skewed statistics, and lets the codes follow local statistics
+ * of data. Encoder and decoder have to use the same threshold.
+ */
 template<std::integral T>
-std::observer_ptr<detail::NodeType<T>> findNodeForSwap(std::observer_ptr<detail::NodeType<T>> root,
-                                                       std::observer_ptr<detail::NodeType<T>> node,
-                                                       std::observer_ptr<detail::NodeType<T>> inspectedNode) {
-  if (inspectedNode == root) { return inspectedNode; }
-
-  if ((*inspectedNode)->weight == (*node)->weight && node != inspectedNode->getParent()
-      && (*inspectedNode)->order < (*node)->order) {
-    inspectedNode = node;
+class AdaptiveTree {
+  static_assert(sizeof(T) == 1, "Adaptive codes store values of new symbols in 9 bits");
+
+ public:
+  using NodeIndex = uint16_t;
+  // orders of all nodes of a tree with 256 symbols and NYT node
+  constexpr static auto NODE_COUNT = std::size_t{2 * ValueCount<T> + 1};
+  constexpr static auto ROOT = static_cast<NodeIndex>(NODE_COUNT - 1);
+  constexpr static auto NONE = NodeIndex{0xFFFF};
+
+  /**
+   * @param rescaleThreshold sum of weights at which weights are halved, 0 to never halve them
+   */
+  explicit AdaptiveTree(std::size_t rescaleThreshold = 0) : rescaleThreshold(rescaleThreshold) {
+    contents[ROOT] = NYT_CONTENT;
+    parents[ROOT] = NONE;
+    symbolNodes.fill(NONE);
+    rebuildBlocks();
   }
 
-  if (node->hasLeft()) { inspectedNode = findNodeForSwap(root, std::make_observer(&node->getLeft()), inspectedNode); }
-  if (node->hasRight()) { inspectedNode = findNodeForSwap(root, std::make_observer(&node->getRight()), inspectedNode); }
-  return inspectedNode;
-}
+  [[nodiscard]] NodeIndex getNYTNode() const { return nytNode; }
+  /**
+   * @return leaf of symbol, NONE if the symbol hasn't been added to the tree yet
+   */
+  [[nodiscard]] NodeIndex getSymbolNode(T symbol) const {
+    return symbolNodes[static_cast<std::make_unsigned_t<T>>(symbol)];
+  }
 
-template<std::integral T>
-void slideAndIncrement(detail::TreeType<T> &tree, detail::NodeType<T> &node) {
-  auto root = std::make_observer(&tree.getRoot());
-  auto nodeToSwapWith = findNodeForSwap(root, root, std::make_observer(&node));
-  if (nodeToSwapWith.get() != &node) {
-    swapNodes(nodeToSwapWith, std::make_observer(&node));
-    std::swap((*nodeToSwapWith)->order, node->order);
+  [[nodiscard]] bool isLeaf(NodeIndex node) const { return (contents[node] & LEAF_FLAG) != 0; }
+  [[nodiscard]] bool isNYT(NodeIndex node) const { return contents[node] == NYT_CONTENT; }
+  [[nodiscard]] T getSymbol(NodeIndex node) const { return static_cast<T>(contents[node] & ~LEAF_FLAG); }
+  [[nodiscard]] NodeIndex getLeft(NodeIndex node) const { return contents[node]; }
+  [[nodiscard]] NodeIndex getRight(NodeIndex node) const { return static_cast<NodeIndex>(contents[node] + 1); }
+  [[nodiscard]] NodeIndex getParent(NodeIndex node) const { return parents[node]; }
+
+  /**
+   * Update tree after symbol has been processed, a new symbol is added by splitting NYT node.
+   * @param symbol processed symbol
+   */
+  void update(T symbol) {
+    auto node = getSymbolNode(symbol);
+    if (node == NONE) { node = splitNYT(symbol); }
+    slideAndIncrement(node);
+    if (rescaleThreshold != 0 && weights[ROOT] >= rescaleThreshold) { rescale(); }
   }
 
-  ++node->weight;
-  if (!node.isRoot()) { slideAndIncrement(tree, *node.getParent()); }
-}
+ private:
+  constexpr static auto LEAF_FLAG = NodeIndex{0x8000};
+  constexpr static auto NYT_CONTENT = static_cast<NodeIndex>(LEAF_FLAG | ValueCount<T>);
 
-template<std::integral T>
-std::observer_ptr<detail::NodeType<T>> updateTree(detail::TreeType<T> &tree, T symbol,
-                                                  std::observer_ptr<detail::NodeType<T>> nytNode,
-                                                  detail::NodeCacheArray<T> &nodeCacheArray) {
-  auto symbolNode = nodeCacheArray[symbol];
-  if (symbolNode == nullptr) {
-    (*nytNode)->isNYT = false;
-    const auto currentOrder = (*nytNode)->order;
-    auto &left = nytNode->makeLeft(makeNYTAdaptive<T>(currentOrder - 2));
-    auto &right = nytNode->makeRight(AdaptiveEncodingTreeData<T>{symbol, 0, false, currentOrder - 1});
-    symbolNode = std::make_observer(&right);
-    nodeCacheArray[symbol] = symbolNode;
-    nytNode = std::make_observer(&left);
+  /**
+   * NYT node becomes parent of a new NYT node and a leaf of symbol.
+   * @return leaf of symbol
+   */
+  NodeIndex splitNYT(T symbol) {
+    const auto parent = nytNode;
+    const auto left = static_cast<NodeIndex>(parent - 2);
+    const auto right = static_cast<NodeIndex>(parent - 1);
+    contents[parent] = left;
+    contents[left] = NYT_CONTENT;
+    contents[right] = static_cast<NodeIndex>(LEAF_FLAG | static_cast<std::make_unsigned_t<T>>(symbol));
+    parents[left] = parents[right] = parent;
+    weights[left] = weights[right] = 0;
+    symbolNodes[static_cast<std::make_unsigned_t<T>>(symbol)] = right;
+    nytNode = left;
+    assignBlock(right);
+    assignBlock(left);
+    return right;
+  }
+
+  /**
+   * Increment weight of node and all its ancestors, keeping the sibling property.
+   * @details Each node on the path to the root is swapped with the leader of its block first, so an update costs
+   * O(depth). The only node whose parent has the same weight is the sibling of NYT node, its parent directly follows
+   * it in order, so both of them are incremented in place.
+   */
+  void slideAndIncrement(NodeIndex node) {
+    while (node != NONE) {
+      const auto leader = leaders[blocks[node]];
+      if (leader == parents[node]) {
+        increment(leader);
+        increment(node);
+        node = parents[leader];
+        continue;
+      }
+      swap(node, leader);
+      increment(leader);
+      node = parents[leader];
+    }
+  }
+
+  /**
+   * Halve weights of all symbols and rebuild the tree from them.
+   * @details Leaves ordered by their orders are sorted by weight and halving keeps them sorted. Huffman construction
+   * with two queues - one of leaves and one of created internal nodes - takes nodes in order of their weights, so each
+   * node gets the next order as it's taken and the sibling property holds. Weights are rounded up, so only NYT node
+   * keeps zero weight. Internal nodes are taken before leaves of the same weight, so the parent of NYT node directly
+   * follows its sibling, as slideAndIncrement expects.
+   */
+  void rescale() {
+    // weight and content of each node
+    auto leaves = std::array<std::pair<std::size_t, NodeIndex>, ValueCount<T> + 1>{};
+    auto internalNodes = std::array<std::pair<std::size_t, NodeIndex>, ValueCount<T>>{};
+    auto leafCount = std::size_t{};
+    for (auto node = std::size_t{nytNode}; node <= ROOT; ++node) {
+      if (isLeaf(static_cast<NodeIndex>(node))) { leaves[leafCount++] = {(weights[node] + 1) / 2, contents[node]}; }
+    }
+
+    auto leafIndex = std::size_t{};
+    auto internalBegin = std::size_t{};
+    auto internalEnd = std::size_t{};
+    auto order = nytNode;
+    const auto takeNode = [&] {
+      const auto isLeafTaken = internalBegin == internalEnd
+          || (leafIndex < leafCount && leaves[leafIndex].first < internalNodes[internalBegin].first);
+      std::tie(weights[order], contents[order]) = isLeafTaken ? leaves[leafIndex++] : internalNodes[internalBegin++];
+      adopt(order);
+      return order++;
+    };
+    while (order < ROOT) {
+      const auto left = takeNode();
+      const auto right = takeNode();
+      internalNodes[internalEnd++] = {weights[left] + weights[right], left};
+    }
+    takeNode();
+    rebuildBlocks();
+  }
+
+  /**
+   * Swap contents of two nodes of the same weight.
+   */
+  void swap(NodeIndex first, NodeIndex second) {
+    if (first == second) { return; }
+    std::swap(contents[first], contents[second]);
+    adopt(first);
+    adopt(second);
+  }
+
+  /**
+   * Point children or symbol of node's content back to it after the content has been moved.
+   */
+  void adopt(NodeIndex node) {
+    if (isNYT(node)) {
+      nytNode = node;
+    } else if (isLeaf(node)) {
+      symbolNodes[static_cast<std::make_unsigned_t<T>>(getSymbol(node))] = node;
+    } else {
+      parents[getLeft(node)] = parents[getRight(node)] = node;
+    }
+  }
+
+  /**
+   * Increment weight of a leader of its block, moving it to the next block.
+   */
+  void increment(NodeIndex node) {
+    const auto block = blocks[node];
+    assert(leaders[block] == node);
+    ++weights[node];
+    if (node > nytNode && blocks[node - 1] == block) {
+      leaders[block] = static_cast<NodeIndex>(node - 1);
+    } else {
+      freeBlocks[freeBlockCount++] = block;
+    }
+    assignBlock(node);
   }
 
-  slideAndIncrement(tree, *symbolNode);
+  /**
+   * Assign blocks to all nodes from scratch.
+   */
+  void rebuildBlocks() {
+    std::ranges::generate(freeBlocks, [block = NodeIndex{}]() mutable { return block++; });
+    freeBlockCount = NODE_COUNT;
+    for (auto node = std::size_t{ROOT} + 1; node-- > nytNode;) { assignBlock(static_cast<NodeIndex>(node)); }
+  }
 
-  return nytNode;
+  /**
+   * Node joins the block of the next node if their weights are equal, otherwise it becomes the leader of a new block.
+   */
+  void assignBlock(NodeIndex node) {
+    if (node < ROOT && weights[node + 1] == weights[node]) {
+      blocks[node] = blocks[node + 1];
+      return;
+    }
+    blocks[node] = freeBlocks[--freeBlockCount];
+    leaders[blocks[node]] = node;
+  }
+
+  std::array<std::size_t, NODE_COUNT> weights{};
+  // order of left child for internal nodes, symbol with LEAF_FLAG for leaves
+  std::array<NodeIndex, NODE_COUNT> contents{};
+  std::array<NodeIndex, NODE_COUNT> parents{};
+  // block of node with given order
+  std::array<NodeIndex, NODE_COUNT> blocks{};
+  // order of leader of each block
+  std::array<NodeIndex, NODE_COUNT> leaders{};
+  std::array<NodeIndex, NODE_COUNT> freeBlocks{};
+  std::size_t freeBlockCount = NODE_COUNT;
+  std::array<NodeIndex, ValueCount<T>> symbolNodes{};
+  NodeIndex nytNode = ROOT;
+  std::size_t rescaleThreshold;
+};
+}// namespace detail
+
+/**
+ * Read a single symbol from input - walk the tree from the root to a leaf, NYT leaf is followed by 9 bit symbol value.
+ * @param reader input data
+ * @param tree the current tree
+ * @return decoded symbol, the result is invalid if the reader is overrun
+ */
+template<std::integral T>
+T readAdaptiveSymbol(BitReader &reader, const detail::AdaptiveTree<T> &tree) {
+  auto node = detail::AdaptiveTree<T>::ROOT;
+  while (!tree.isLeaf(node)) { node = reader.readBit() ? tree.getRight(node) : tree.getLeft(node); }
+  if (tree.isNYT(node)) { return static_cast<T>(reader.read(9)); }
+  return tree.getSymbol(node);
 }
 
 }
@@ -8,6 +8,7 @@
 #ifndef HUFF_CODEC__ADAPTIVE_DECODING_H
 #define HUFF_CODEC__ADAPTIVE_DECODING_H
 
+#include "BitReader.h"
 #include "adaptive_common.h"
 #include "models.h"
 #include <concepts>
@@ -15,64 +16,28 @@
 #include <tl/expected.hpp>
 
 namespace pf::kko {
+/**
+ * Decode data encoded via @see encodeAdaptive<T> function.
+ * @param data input data
+ * @param model model used during encoding
+ * @param rescaleThreshold threshold used during encoding, @see detail::AdaptiveTree
+ * @return unexpected when error occurs, otherwise decoded data
+ */
 template<std::integral T>
-tl::expected<std::vector<T>, std::string> decodeAdaptive(std::ranges::forward_range auto &&data,
-                                                         Model<T> auto &&model) {
-  enum class State { Tree, Value };
-  auto tree = detail::TreeType<T>{};
-  tree.setRoot(makeUniqueNode(makeNYTAdaptive<T>()));
-
-  auto symbolNodes = detail::NodeCacheArray<T>{nullptr};
-
-  auto node = std::make_observer(&tree.getRoot());
-  auto nytNode = node;
+tl::expected<std::vector<T>, std::string> decodeAdaptive(std::ranges::contiguous_range auto &&data,
+                                                         Model<T> auto &&model, std::size_t rescaleThreshold = 0) {
+  auto tree = detail::AdaptiveTree<T>{rescaleThreshold};
 
   auto result = std::vector<T>{};
 
-  auto inspectedCode = std::vector<bool>{};
-  auto state = State::Value;
-  bool done = false;
-  std::ranges::for_each(data, [&](const auto byte) {
-    if (done) { return; }
-    forEachBit(byte, [&](bool bit) {
-      if (done) { return; }
-      switch (state) {
-        case State::Tree: {
-          if (bit) {
-            node = std::make_observer(&node->getRight());
-          } else {
-            node = std::make_observer(&node->getLeft());
-          }
-          break;
-        }
-        case State::Value: {
-          break;
-        }
-      }
-      auto symbol = std::optional<T>{};
-      if (node->isLeaf() && !(*node)->isNYT) {
-        symbol = (*node)->value;
-      } else if ((*node)->isNYT) {
-        if (state == State::Value) { inspectedCode.template emplace_back(bit); }
-        state = State::Value;
-        if (inspectedCode.size() == 9) {
-          symbol = binToIntegral<T>(inspectedCode);
-          inspectedCode.clear();
-          state = State::Tree;
-        }
-      }
-
-      if (symbol.has_value()) {
-        if (*symbol == PSEUDO_EOF<T>) {
-          done = true;
-          return;
-        }
-        nytNode = updateTree(tree, *symbol, nytNode, symbolNodes);
-        node = std::make_observer(&tree.getRoot());
-        result.emplace_back(*symbol);
-      }
-    });
-  });
+  auto reader = BitReader{std::span<const uint8_t>{std::ranges::data(data), std::ranges::size(data)}};
+  while (!reader.isExhausted()) {
+    const auto symbol = readAdaptiveSymbol<T>(reader, tree);
+    // incomplete code means end of data - padding after EOF
+    if (reader.isOverrun() || symbol == PSEUDO_EOF<T>) { break; }
+    tree.update(symbol);
+    result.emplace_back(symbol);
+  }
 
   std::ranges::transform(result, std::ranges::begin(result), makeRevertLambda<T>(model));
   return result;
@@ -7,86 +7,82 @@
 #ifndef HUFF_CODEC__ADAPTIVE_ENCODING_H
 #define HUFF_CODEC__ADAPTIVE_ENCODING_H
 
-#include "BinaryEncoder.h"
-#include "EncodingTreeData.h"
-#include "Tree.h"
+#include "BitWriter.h"
 #include "adaptive_common.h"
 #include "models.h"
 #include <algorithm>
+#include <spdlog/spdlog.h>
 
 namespace pf::kko {
 
-namespace detail {
-template<std::integral T>
-bool getPathToSymbolImpl(detail::NodeType<T> &root, detail::NodeType<T> &targetNode, std::vector<bool> &result) {
-  if (&root == &targetNode) { return true; }
-  if (root.hasLeft()) {
-    if (getPathToSymbolImpl(root.getLeft(), targetNode, result)) {
-      result.emplace_back(false);
-      return true;
-    }
-  }
-  if (result.empty() && root.hasRight()) {
-    if (getPathToSymbolImpl(root.getRight(), targetNode, result)) {
-      result.emplace_back(true);
-      return true;
-    }
-  }
-  return false;
-}
-}// namespace detail
-
+/**
+ * Find code of a node in the tree.
+ * @details The path is walked from the node up to the root via parent links. Bits come in reverse order, the last bit
+ * of the code first, which is the order in which BitCode stores them - from the least significant bit. Codes are
+ * expected to fit into 64 bits, which requires more than 10^13 encoded symbols to break.
+ * @param tree the current tree
+ * @param targetNode searched node
+ * @return path from root to targetNode
+ */
 template<std::integral T>
-std::vector<bool> getPathToSymbol(detail::NodeType<T> &root, detail::NodeType<T> &targetNode) {
-  if (&root == &targetNode) { return {}; }
-  auto result = std::vector<bool>{};
-  if (root.hasLeft()) {
-    if (detail::getPathToSymbolImpl(root.getLeft(), targetNode, result)) { result.emplace_back(false); }
-  }
-  if (result.empty() && root.hasRight()) {
-    if (detail::getPathToSymbolImpl(root.getRight(), targetNode, result)) { result.emplace_back(true); }
+BitCode getPathToSymbol(const detail::AdaptiveTree<T> &tree, typename detail::AdaptiveTree<T>::NodeIndex targetNode) {
+  auto result = BitCode{};
+  for (auto node = targetNode; node != detail::AdaptiveTree<T>::ROOT; node = tree.getParent(node)) {
+    assert(result.length < BitCode::MAX_LENGTH);
+    const auto isRightChild = node != tree.getLeft(tree.getParent(node));
+    result.bits |= static_cast<uint64_t>(isRightChild) << result.length;
+    ++result.length;
   }
-  std::reverse(result.begin(), result.end());
   return result;
 }
 
 /**
  * Vitter algorithm implementation of adaptive huffman encoding.
+ * @details Residuals of model are computed while they're encoded, data is never modified. So data can be e.g.
+ * std::span<const T> over read-only memory.
  * @param data data to be encoded
  * @param model
- * @return encoded data using adaptive huffman encoding
+ * @param sink destination of data encoded using adaptive huffman encoding
+ * @param rescaleThreshold sum of weights at which weights of adaptive tree are halved, 0 to never halve them. The
+ * same threshold has to be used for decoding.
  */
 template<std::integral T>
-std::vector<uint8_t> encodeAdaptive(std::ranges::forward_range auto &&data, Model<T> auto &&model) {
-  std::ranges::transform(data, std::ranges::begin(data), makeApplyLambda<T>(model));
-  // speedup for leaf node lookup - no need to traverse the tree
-  auto symbolNodes = detail::NodeCacheArray<T>{nullptr};
-
-  auto tree = detail::TreeType<T>{};
-
-  tree.setRoot(makeUniqueNode(makeNYTAdaptive<T>()));
-  auto nytNode = std::make_observer(&tree.getRoot());
+void encodeAdaptive(const std::ranges::forward_range auto &data, Model<T> auto &&model, ByteSink auto &sink,
+                    std::size_t rescaleThreshold = 0) {
+  auto applyModel = makeApplyLambda<T>(model);
+  auto tree = detail::AdaptiveTree<T>{rescaleThreshold};
   spdlog::trace("Tree initialised");
 
-  auto binEncoder = BinaryEncoder<uint8_t>{};
+  auto binEncoder = BitWriter{sink};
 
-  for (auto symbol : data) {
-    auto code = std::vector<bool>{};
-    if (symbolNodes[symbol] != nullptr) {
-      code = getPathToSymbol<T>(tree.getRoot(), *symbolNodes[symbol]);
+  for (const auto &value : data) {
+    const auto symbol = applyModel(value);
+    if (const auto symbolNode = tree.getSymbolNode(symbol); symbolNode != detail::AdaptiveTree<T>::NONE) {
+      binEncoder.pushBits(getPathToSymbol<T>(tree, symbolNode));
     } else {
-      code = getPathToSymbol<T>(tree.getRoot(), *nytNode);
-      std::ranges::copy(typeToBits(symbol, 9), std::back_inserter(code));
+      binEncoder.pushBits(getPathToSymbol<T>(tree, tree.getNYTNode()));
+      binEncoder.pushBits(symbol, 9);
     }
-    binEncoder.pushBack(code);
-    nytNode = updateTree(tree, symbol, nytNode, symbolNodes);
+    tree.update(symbol);
   }
   // adding PSEUDO_EOF
-  const auto eofCode = getPathToSymbol<T>(tree.getRoot(), *nytNode);
-  binEncoder.pushBack(eofCode);
+  const auto eofCode = getPathToSymbol<T>(tree, tree.getNYTNode());
+  binEncoder.pushBits(eofCode);
   spdlog::info("Done, output data size: {}[b]", binEncoder.size());
 
-  return binEncoder.releaseData();
+  binEncoder.flush();
+}
+
+/**
+ * Encoding to memory, @see encodeAdaptive above.
+ * @return encoded data using adaptive huffman encoding
+ */
+template<std::integral T>
+std::vector<uint8_t> encodeAdaptive(const std::ranges::forward_range auto &data, Model<T> auto &&model,
+                                    std::size_t rescaleThreshold = 0) {
+  auto sink = VectorSink{};
+  encodeAdaptive<T>(data, std::forward<decltype(model)>(model), sink, rescaleThreshold);
+  return sink.releaseData();
 }
 }// namespace pf::kko
 #endif//HUFF_CODEC__ADAPTIVE_ENCODING_H
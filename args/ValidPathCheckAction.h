@@ -7,7 +7,7 @@
 #include "../libs/fmt/format.h"
 #include <filesystem>
 
-enum class PathType { File, Directory };
+enum class PathType { File, Directory, FileOrDirectory };
 
 struct ValidPathCheckAction {
   explicit inline ValidPathCheckAction(PathType pathType, bool mustExist) : type(pathType), exists(mustExist) {}
@@ -20,6 +20,10 @@ struct ValidPathCheckAction {
       if (type == PathType::File && !std::filesystem::is_regular_file(path)) {
         throw std::runtime_error{fmt::format("Provided path: '{}' is not a file.", pathStr)};
       }
+      if (type == PathType::FileOrDirectory && !std::filesystem::is_regular_file(path)
+          && !std::filesystem::is_directory(path)) {
+        throw std::runtime_error{fmt::format("Provided path: '{}' is neither a file nor a directory.", pathStr)};
+      }
     }
     return path;
   }
@@ -15,14 +15,23 @@
 #include "adaptive_blocks_encoding.h"
 #include "adaptive_decoding.h"
 #include "adaptive_encoding.h"
+#include "BinaryEncoder.h"
+#include "BitWriter.h"
 #include "argparse.hpp"
 #include "args/ValidPathCheckAction.h"
 #include "fmt/core.h"
 #include "fmt/ostream.h"
+#include "histogram.h"
 #include "magic_enum.hpp"
+#include "size_estimation.h"
 #include "spdlog/spdlog.h"
+#include "static_batch_decoding.h"
+#include "static_chunks_decoding.h"
+#include "static_chunks_encoding.h"
 #include "static_decoding.h"
+#include "static_dictionary.h"
 #include "static_encoding.h"
+#include <numeric>
 #include <optional>
 #include <span>
 #define ANKERL_NANOBENCH_IMPLEMENT
@@ -30,6 +39,9 @@
 using namespace pf::kko;
 
 constexpr auto IMAGE_WIDTH = 512;
+constexpr auto STATIC_CHUNK_SIZE = std::size_t{64 * 1024};
+constexpr auto SMALL_STREAM_SIZE = std::size_t{4 * 1024};
+constexpr auto ADAPTIVE_RESCALE_THRESHOLD = std::size_t{64 * 1024};
 
 std::function<std::vector<uint8_t>(std::vector<uint8_t> &&)> getEncodeFnc(bool enableStatic, bool enableModel,
                                                                           bool adaptive) {
@@ -127,11 +139,252 @@ std::optional<argparse::ArgumentParser> parseArgs(std::span<char *> args) {
   return parser;
 }
 
+/**
+ * Comparison of per bit BinaryEncoder output with word-at-a-time BitWriter for static huffman codes of data.
+ */
+void benchBitWriters(const std::string &fileName, const std::vector<uint8_t> &data) {
+  using namespace ankerl::nanobench;
+  const auto histogram = createHistogram<uint8_t>(data);
+  const auto symbolCodes = buildCanonicalCodes<uint8_t>(histogram);
+  auto codeTable = std::array<BitCode, 256>{};
+  for (const auto &[symbol, code] : symbolCodes) { codeTable[symbol] = code; }
+
+  auto bench = Bench();
+  bench.title(fmt::format("Bit writer bench for file: {}", fileName))
+      .relative(true)
+      .warmup(5)
+      .performanceCounters(true)
+      .batch(data.size())
+      .unit("B");
+  bench.run("BinaryEncoder::pushBack", [&] {
+    auto encoder = BinaryEncoder<uint8_t>{};
+    for (const auto symbol : data) { encoder.pushBack(codeTable[symbol]); }
+    doNotOptimizeAway(encoder.releaseData());
+  });
+  bench.run("BitWriter::pushBits", [&] {
+    auto sink = VectorSink{data.size()};
+    auto writer = BitWriter{sink};
+    for (const auto symbol : data) { writer.pushBits(codeTable[symbol]); }
+    writer.flush();
+    doNotOptimizeAway(sink.releaseData());
+  });
+}
+
+/**
+ * Comparison of histogram kernels on raw data and on output of NeighborDifferenceModel, which is mostly flat.
+ */
+void benchHistograms(const std::string &fileName, const std::vector<uint8_t> &data) {
+  using namespace ankerl::nanobench;
+  auto modelData = data;
+  std::ranges::transform(modelData, modelData.begin(), makeApplyLambda<uint8_t>(NeighborDifferenceModel<uint8_t>{}));
+  for (const auto &[dataName, input] : {std::pair{"raw", std::cref(data)}, std::pair{"model", std::cref(modelData)}}) {
+    const auto &bytes = input.get();
+    auto bench = Bench();
+    bench.title(fmt::format("Histogram bench for file: {} ({})", fileName, dataName))
+        .relative(true)
+        .warmup(5)
+        .performanceCounters(true)
+        .batch(bytes.size())
+        .unit("B");
+    bench.run("Naive", [&] { doNotOptimizeAway(createHistogramNaive<uint8_t>(bytes)); });
+    bench.run("Multi-way", [&] { doNotOptimizeAway(createHistogramMultiWay<uint8_t>(bytes)); });
+    bench.run("Word-wise", [&] { doNotOptimizeAway(createHistogramWordWise<uint8_t>(bytes)); });
+    bench.run("Parallel", [&] { doNotOptimizeAway(createHistogramParallel<uint8_t>(bytes)); });
+  }
+  auto bench = Bench();
+  bench.title(fmt::format("Model and histogram bench for file: {}", fileName))
+      .relative(true)
+      .warmup(5)
+      .performanceCounters(true)
+      .batch(data.size())
+      .unit("B");
+  auto residuals = data;
+  bench.run("Apply model, then word-wise", [&] {
+    std::ranges::transform(data, residuals.begin(), makeApplyLambda<uint8_t>(NeighborDifferenceModel<uint8_t>{}));
+    doNotOptimizeAway(createHistogramWordWise<uint8_t>(residuals));
+  });
+  bench.run("Fused model and word-wise", [&] {
+    doNotOptimizeAway(createHistogram<uint8_t>(data, NeighborDifferenceModel<uint8_t>{}));
+  });
+}
+
+/**
+ * Print compression ratio cost of length limited static codes against unlimited ones.
+ */
+void reportCodeLengthLimits(const std::string &fileName, const std::vector<uint8_t> &data) {
+  fmt::print("Code length limit cost for file: {}\n", fileName);
+  for (const auto enableModel : {false, true}) {
+    const auto encode = [&](std::size_t maxCodeLength) {
+      auto d = data;
+      const auto options = StaticEncodingOptions{.maxCodeLength = maxCodeLength};
+      if (enableModel) {
+        return encodeStatic<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{}, options).size();
+      }
+      return encodeStatic<uint8_t>(std::move(d), IdentityModel<uint8_t>{}, options).size();
+    };
+    const auto unlimitedSize = encode(0);
+    fmt::print("  {:<8} unlimited: {}[B] BPC: {:.4f}\n", enableModel ? "model" : "no model", unlimitedSize,
+               countBitsPerCharacter(data.size(), unlimitedSize));
+    for (const auto maxCodeLength : {8, 10, 11, 12, 16}) {
+      const auto size = encode(maxCodeLength);
+      fmt::print("  {:<8} max {:>2} bits: {}[B] BPC: {:.4f} cost: {:+.3f}%\n", enableModel ? "model" : "no model",
+                 maxCodeLength, size, countBitsPerCharacter(data.size(), size),
+                 (static_cast<double>(size) / unlimitedSize - 1) * 100);
+    }
+  }
+}
+
+/**
+ * Compare static streams with their own tables against streams sharing a dictionary trained on all of them.
+ */
+void benchSmallStreams(const std::string &fileName, const std::vector<uint8_t> &data) {
+  using namespace ankerl::nanobench;
+  auto streams = std::vector<std::vector<uint8_t>>{};
+  for (std::size_t offset = 0; offset + SMALL_STREAM_SIZE <= data.size(); offset += SMALL_STREAM_SIZE) {
+    streams.emplace_back(data.begin() + static_cast<std::ptrdiff_t>(offset),
+                         data.begin() + static_cast<std::ptrdiff_t>(offset + SMALL_STREAM_SIZE));
+  }
+  if (streams.empty()) { return; }
+  const auto dictionary = trainStaticDictionary<uint8_t>(streams, NeighborDifferenceModel<uint8_t>{}, 16).value();
+  auto encodedOwn = std::vector<std::vector<uint8_t>>{};
+  auto encodedShared = std::vector<std::vector<uint8_t>>{};
+  for (const auto &stream : streams) {
+    auto d1 = stream;
+    encodedOwn.emplace_back(encodeStatic<uint8_t>(std::move(d1), NeighborDifferenceModel<uint8_t>{}));
+    auto d2 = stream;
+    encodedShared.emplace_back(
+        encodeStaticWithDictionary<uint8_t>(std::move(d2), NeighborDifferenceModel<uint8_t>{}, dictionary));
+  }
+  const auto totalSize = [](const auto &encoded) {
+    return std::accumulate(encoded.begin(), encoded.end(), std::size_t{},
+                           [](auto acc, const auto &stream) { return acc + stream.size(); });
+  };
+  fmt::print("Streams of {}[B] for file: {}, own tables: {}[B], shared dictionary: {}[B] + {}[B] dictionary\n",
+             SMALL_STREAM_SIZE, fileName, totalSize(encodedOwn), totalSize(encodedShared),
+             dictionary.serialize().size());
+
+  auto bench = Bench();
+  bench.title(fmt::format("Small streams bench for file: {}", fileName))
+      .relative(true)
+      .warmup(5)
+      .performanceCounters(true)
+      .batch(streams.size() * SMALL_STREAM_SIZE)
+      .unit("B");
+  bench.run("Encode huffman static model, own tables", [&streams] {
+    for (const auto &stream : streams) {
+      auto d = stream;
+      doNotOptimizeAway(encodeStatic<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{}));
+    }
+  });
+  bench.run("Encode huffman static model, shared dictionary", [&streams, &dictionary] {
+    for (const auto &stream : streams) {
+      auto d = stream;
+      doNotOptimizeAway(
+          encodeStaticWithDictionary<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{}, dictionary));
+    }
+  });
+  bench.run("Decode huffman static model, own tables", [&encodedOwn] {
+    for (const auto &stream : encodedOwn) {
+      doNotOptimizeAway(decodeStatic<uint8_t>(stream, NeighborDifferenceModel<uint8_t>{}));
+    }
+  });
+  auto decoded = std::vector<uint8_t>(streams.size() * SMALL_STREAM_SIZE);
+  auto inputs = std::vector<std::span<const uint8_t>>(encodedOwn.begin(), encodedOwn.end());
+  auto outputs = std::vector<std::span<uint8_t>>{};
+  for (std::size_t offset = 0; offset < decoded.size(); offset += SMALL_STREAM_SIZE) {
+    outputs.emplace_back(decoded.data() + offset, SMALL_STREAM_SIZE);
+  }
+  bench.run(fmt::format("Decode huffman static model, own tables, {} streams at a time", BATCH_DECODE_STREAM_COUNT),
+            [&inputs, &outputs] {
+              doNotOptimizeAway(decodeStaticMany<uint8_t>(inputs, outputs, NeighborDifferenceModel<uint8_t>{}));
+            });
+  bench.run("Decode huffman static model, shared dictionary", [&encodedShared, &dictionary] {
+    for (const auto &stream : encodedShared) {
+      doNotOptimizeAway(decodeStaticWithDictionary<uint8_t>(stream, dictionary, NeighborDifferenceModel<uint8_t>{}));
+    }
+  });
+}
+
+/**
+ * Print compression ratio cost of static codes built from a sampled histogram against codes built from all data.
+ */
+void reportHistogramSampling(const std::string &fileName, const std::vector<uint8_t> &data) {
+  fmt::print("Histogram sampling cost for file: {}\n", fileName);
+  const auto encode = [&](std::size_t sampleStep) {
+    auto d = data;
+    return encodeStatic<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{},
+                                 StaticEncodingOptions{.histogramSampleStep = sampleStep,
+                                                       .histogramSampleRowWidth = IMAGE_WIDTH})
+        .size();
+  };
+  const auto fullSize = encode(1);
+  fmt::print("  all rows: {}[B] BPC: {:.4f}\n", fullSize, countBitsPerCharacter(data.size(), fullSize));
+  for (const auto sampleStep : {4, 8, 16, 64}) {
+    const auto size = encode(sampleStep);
+    fmt::print("  every {:>2}th row: {}[B] BPC: {:.4f} cost: {:+.3f}%\n", sampleStep, size,
+               countBitsPerCharacter(data.size(), size), (static_cast<double>(size) / fullSize - 1) * 100);
+  }
+}
+
+/**
+ * Print estimated encoded sizes of all modes against sizes of actually encoded data and measure cost of estimation.
+ */
+void benchSizeEstimates(const std::string &fileName, const std::vector<uint8_t> &data) {
+  using namespace ankerl::nanobench;
+  const auto estimate = [&](bool enableStatic, bool enableModel, bool adaptive) {
+    if (adaptive) {
+      if (enableModel) {
+        return estimateImageAdaptiveBlocksSize<uint8_t>(data, IMAGE_WIDTH, NeighborDifferenceModel<uint8_t>{});
+      }
+      return estimateImageAdaptiveBlocksSize<uint8_t>(data, IMAGE_WIDTH, IdentityModel<uint8_t>{});
+    }
+    const auto histogram = enableModel ? createHistogram<uint8_t>(data, NeighborDifferenceModel<uint8_t>{})
+                                       : createHistogram<uint8_t>(data, IdentityModel<uint8_t>{});
+    return enableStatic ? estimateStaticSize<uint8_t>(histogram) : estimateAdaptiveSize<uint8_t>(histogram);
+  };
+  fmt::print("Size estimates for file: {}\n", fileName);
+  for (const auto &[enableStatic, adaptive] :
+       {std::pair{true, false}, std::pair{false, false}, std::pair{false, true}}) {
+    for (const auto enableModel : {false, true}) {
+      auto d = data;
+      const auto size = getEncodeFnc(enableStatic, enableModel, adaptive)(std::move(d)).size();
+      const auto estimatedSize = estimate(enableStatic, enableModel, adaptive);
+      fmt::print("  {:<15} {:<8}: {}[B] estimate: {}[B] error: {:+.3f}%\n",
+                 enableStatic ? "static" : (adaptive ? "adaptive blocks" : "adaptive"),
+                 enableModel ? "model" : "no model", size, estimatedSize,
+                 (static_cast<double>(estimatedSize) / size - 1) * 100);
+    }
+  }
+
+  auto bench = Bench();
+  bench.title(fmt::format("Size estimation bench for file: {}", fileName))
+      .relative(true)
+      .warmup(5)
+      .performanceCounters(true)
+      .batch(data.size())
+      .unit("B");
+  bench.run("Estimate static and adaptive model", [&] {
+    doNotOptimizeAway(estimate(true, true, false) + estimate(false, true, false));
+  });
+  bench.run("Estimate adaptive blocks model", [&] { doNotOptimizeAway(estimate(false, true, true)); });
+}
+
 void benchFile(const std::string& fileName, const std::vector<uint8_t> &data) {
   using namespace ankerl::nanobench;
+  reportCodeLengthLimits(fileName, data);
+  reportHistogramSampling(fileName, data);
+  benchSizeEstimates(fileName, data);
+  benchSmallStreams(fileName, data);
+  benchHistograms(fileName, data);
+  benchBitWriters(fileName, data);
   {// encodes
     auto bench = Bench();
-    bench.title(fmt::format("Encode bench for file: {}", fileName)).relative(true).warmup(5).performanceCounters(true);
+    bench.title(fmt::format("Encode bench for file: {}", fileName))
+        .relative(true)
+        .warmup(5)
+        .performanceCounters(true)
+        .batch(data.size())
+        .unit("B");
     bench.run("Encode huffman static no model", [data] {
       auto d = data;
       doNotOptimizeAway(getEncodeFnc(true, false, false)(std::move(d)));
@@ -140,6 +393,35 @@ void benchFile(const std::string& fileName, const std::vector<uint8_t> &data) {
       auto d = data;
       doNotOptimizeAway(getEncodeFnc(true, true, false)(std::move(d)));
     });
+    bench.run("Encode huffman static model, const input without copy", [&data] {
+      doNotOptimizeAway(encodeStatic<uint8_t>(std::span<const uint8_t>{data}, NeighborDifferenceModel<uint8_t>{}));
+    });
+    bench.run("Encode huffman static model, max code length 12", [data] {
+      auto d = data;
+      doNotOptimizeAway(encodeStatic<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{},
+                                              StaticEncodingOptions{.maxCodeLength = 12}));
+    });
+    bench.run("Encode huffman static model, histogram of every 8th row", [data] {
+      auto d = data;
+      doNotOptimizeAway(encodeStatic<uint8_t>(
+          std::move(d), NeighborDifferenceModel<uint8_t>{},
+          StaticEncodingOptions{.histogramSampleStep = 8, .histogramSampleRowWidth = IMAGE_WIDTH}));
+    });
+    bench.run(fmt::format("Encode huffman static model, {} threads", defaultThreadCount()), [data] {
+      auto d = data;
+      doNotOptimizeAway(encodeStatic<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{},
+                                              StaticEncodingOptions{.threadCount = defaultThreadCount()}));
+    });
+    bench.run("Encode huffman static model, interleaved streams", [data] {
+      auto d = data;
+      doNotOptimizeAway(encodeStatic<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{},
+                                              StaticEncodingOptions{.interleaveStreams = true}));
+    });
+    bench.run(fmt::format("Encode huffman static model, chunks of {}", STATIC_CHUNK_SIZE), [data] {
+      auto d = data;
+      doNotOptimizeAway(
+          encodeStaticChunks<uint8_t>(std::move(d), NeighborDifferenceModel<uint8_t>{}, STATIC_CHUNK_SIZE));
+    });
     bench.run("Encode huffman adaptive no model", [data] {
       auto d = data;
       doNotOptimizeAway(getEncodeFnc(false, false, false)(std::move(d)));
@@ -148,6 +430,9 @@ void benchFile(const std::string& fileName, const std::vector<uint8_t> &data) {
       auto d = data;
       doNotOptimizeAway(getEncodeFnc(false, true, false)(std::move(d)));
     });
+    bench.run(fmt::format("Encode huffman adaptive model, rescale at {}", ADAPTIVE_RESCALE_THRESHOLD), [&data] {
+      doNotOptimizeAway(encodeAdaptive<uint8_t>(data, NeighborDifferenceModel<uint8_t>{}, ADAPTIVE_RESCALE_THRESHOLD));
+    });
     bench.run("Encode huffman adaptive adaptive no model", [data] {
       auto d = data;
       doNotOptimizeAway(getEncodeFnc(false, false, true)(std::move(d)));
@@ -159,7 +444,12 @@ void benchFile(const std::string& fileName, const std::vector<uint8_t> &data) {
   }
   {// decodes
     auto bench = Bench();
-    bench.title(fmt::format("Decode bench for file: {}", fileName)).relative(true).warmup(5).performanceCounters(true);
+    bench.title(fmt::format("Decode bench for file: {}", fileName))
+        .relative(true)
+        .warmup(5)
+        .performanceCounters(true)
+        .batch(data.size())
+        .unit("B");
     auto d1 = data;
     auto data1 = getEncodeFnc(true, false, false)(std::move(d1));
     bench.run("Decode huffman static no model", [data1] {
@@ -172,6 +462,19 @@ void benchFile(const std::string& fileName, const std::vector<uint8_t> &data) {
       auto d = data2;
       doNotOptimizeAway(getDecodeFnc(true, true, false)(std::move(d)));
     });
+    auto interleavedData = data;
+    const auto interleavedOptions = StaticEncodingOptions{.interleaveStreams = true};
+    const auto encodedInterleaved =
+        encodeStatic<uint8_t>(std::move(interleavedData), NeighborDifferenceModel<uint8_t>{}, interleavedOptions);
+    bench.run("Decode huffman static model, interleaved streams", [&encodedInterleaved] {
+      doNotOptimizeAway(decodeStatic<uint8_t>(encodedInterleaved, NeighborDifferenceModel<uint8_t>{}));
+    });
+    auto chunkData = data;
+    const auto encodedChunks = encodeStaticChunks<uint8_t>(std::move(chunkData), NeighborDifferenceModel<uint8_t>{},
+                                                           STATIC_CHUNK_SIZE);
+    bench.run(fmt::format("Decode huffman static model, chunks of {}", STATIC_CHUNK_SIZE), [&encodedChunks] {
+      doNotOptimizeAway(decodeStaticChunks<uint8_t>(encodedChunks, NeighborDifferenceModel<uint8_t>{}));
+    });
     auto d3 = data;
     auto data3 = getEncodeFnc(false, false, false)(std::move(d3));
     bench.run("Decode huffman adaptive no model", [data3] {
@@ -184,6 +487,13 @@ void benchFile(const std::string& fileName, const std::vector<uint8_t> &data) {
       auto d = data4;
       doNotOptimizeAway(getDecodeFnc(false, true, false)(std::move(d)));
     });
+    const auto encodedRescaled =
+        encodeAdaptive<uint8_t>(data, NeighborDifferenceModel<uint8_t>{}, ADAPTIVE_RESCALE_THRESHOLD);
+    bench.run(fmt::format("Decode huffman adaptive model, rescale at {}", ADAPTIVE_RESCALE_THRESHOLD),
+              [&encodedRescaled] {
+                doNotOptimizeAway(decodeAdaptive<uint8_t>(encodedRescaled, NeighborDifferenceModel<uint8_t>{},
+                                                          ADAPTIVE_RESCALE_THRESHOLD));
+              });
     auto d5 = data;
     auto data5 = getEncodeFnc(false, false, true)(std::move(d5));
     bench.run("Decode huffman adaptive adaptive no model", [data5] {
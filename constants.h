@@ -7,9 +7,21 @@
 #ifndef HUFF_CODEC__CONSTANTS_H
 #define HUFF_CODEC__CONSTANTS_H
 
+#include <cstdint>
+
 namespace pf::kko {
 constexpr auto PADDING_MASK = 0b11100000;
 constexpr auto PADDING_SHIFT = 5;
+/**
+ * Set in the first byte of static stream, which consists of INTERLEAVED_STREAM_COUNT streams.
+ */
+constexpr auto INTERLEAVED_STREAMS_FLAG = 0b10000000;
+constexpr auto INTERLEAVED_STREAM_COUNT = std::size_t{4};
+/**
+ * The first byte of static stream encoded with a dictionary. Header of static stream never starts with it, since its
+ * first byte holds the maximum code length + 1 and codes are at least 1 bit long.
+ */
+constexpr auto DICTIONARY_STREAM_MARKER = uint8_t{0b00000001};
 
 using Dimensions = std::pair<std::size_t, std::size_t>;
 
@@ -0,0 +1,277 @@
+/**
+ * @name histogram.h
+ * @brief kernels for counting symbol occurrences
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__HISTOGRAM_H
+#define HUFF_CODEC__HISTOGRAM_H
+
+#include "View2D.h"
+#include "models.h"
+#include "parallel.h"
+#include "utils.h"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <cstring>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <variant>
+
+namespace pf::kko {
+template<std::integral T>
+using Histogram = std::array<std::size_t, ValueCount<T>>;
+
+/**
+ * Inputs larger than this are counted on multiple threads by createHistogram.
+ */
+constexpr std::size_t PARALLEL_HISTOGRAM_THRESHOLD = 4 * 1024 * 1024;
+
+namespace detail {
+template<std::size_t Ways, std::integral T>
+Histogram<T> mergeHistograms(const std::array<Histogram<T>, Ways> &histograms) {
+  auto result = Histogram<T>{};
+  for (const auto &histogram : histograms) {
+    std::ranges::transform(result, histogram, result.begin(), std::plus{});
+  }
+  return result;
+}
+
+template<typename R>
+concept ByteRange = std::ranges::contiguous_range<R> && std::ranges::sized_range<R>
+    && sizeof(std::ranges::range_value_t<R>) == 1;
+}// namespace detail
+
+/**
+ * Straightforward histogram with a single counter per symbol.
+ * @details Equal neighboring symbols increment the same counter, so each increment waits for the previous one.
+ */
+template<std::integral T>
+Histogram<T> createHistogramNaive(const std::ranges::forward_range auto &data) {
+  auto result = Histogram<T>{};
+  std::ranges::for_each(data, [&result](const auto value) { ++result[static_cast<std::make_unsigned_t<T>>(value)]; });
+  return result;
+}
+
+/**
+ * Histogram counted into several interleaved sub-histograms, which are summed at the end. Runs of equal symbols
+ * increment different counters, so the increments don't depend on each other.
+ * @tparam Ways amount of sub-histograms
+ */
+template<std::integral T, std::size_t Ways = 4>
+Histogram<T> createHistogramMultiWay(const std::ranges::forward_range auto &data) {
+  static_assert(Ways > 0);
+  auto histograms = std::array<Histogram<T>, Ways>{};
+  auto iter = std::ranges::begin(data);
+  const auto end = std::ranges::end(data);
+  for (auto remaining = std::ranges::distance(data); remaining >= static_cast<decltype(remaining)>(Ways);
+       remaining -= Ways) {
+    for (std::size_t way = 0; way < Ways; ++way, ++iter) {
+      ++histograms[way][static_cast<std::make_unsigned_t<T>>(*iter)];
+    }
+  }
+  for (; iter != end; ++iter) { ++histograms[0][static_cast<std::make_unsigned_t<T>>(*iter)]; }
+  return detail::mergeHistograms<Ways, T>(histograms);
+}
+
+namespace detail {
+/**
+ * Counters of createHistogramWordWise, data can be added in several parts.
+ * @details Data are loaded a 64 bit word at a time and each byte is extracted with a shift into one of 8 sub-histograms
+ * of 32 bit counters, so counting itself is scalar like in createHistogramMultiWay. Only a block of 32 bytes consisting
+ * of a single repeated byte (e.g. a run of zeros produced by NeighborDifferenceModel) is recognized on whole words and
+ * counted with a single addition.
+ */
+template<std::integral T>
+requires(sizeof(T) == 1) class WordHistogram {
+ public:
+  void add(std::span<const uint8_t> data) {
+    while (!data.empty()) {
+      const auto segment = data.first(std::min(SEGMENT_SIZE - segmentBytes, data.size()));
+      countSegment(segment);
+      data = data.subspan(segment.size());
+      segmentBytes += segment.size();
+      if (segmentBytes == SEGMENT_SIZE) { flushSegment(); }
+    }
+  }
+
+  [[nodiscard]] Histogram<T> getResult() {
+    flushSegment();
+    return result;
+  }
+
+ private:
+  constexpr static auto WAYS = std::size_t{8};
+  constexpr static auto WORD_SIZE = sizeof(uint64_t);
+  constexpr static auto BLOCK_SIZE = 4 * WORD_SIZE;
+  constexpr static auto BROADCAST = uint64_t{0x0101010101010101};
+  // 32 bit counters can't overflow within a segment
+  constexpr static auto SEGMENT_SIZE = std::size_t{1} << 30;
+
+  void countSegment(std::span<const uint8_t> segment) {
+    auto position = std::size_t{};
+    for (; position + BLOCK_SIZE <= segment.size(); position += BLOCK_SIZE) {
+      auto words = std::array<uint64_t, BLOCK_SIZE / WORD_SIZE>{};
+      std::memcpy(words.data(), segment.data() + position, BLOCK_SIZE);
+      const auto run = (words[0] & 0xFF) * BROADCAST;
+      if (((words[0] ^ run) | (words[1] ^ run) | (words[2] ^ run) | (words[3] ^ run)) == 0) {
+        histograms[0][words[0] & 0xFF] += BLOCK_SIZE;
+        continue;
+      }
+      for (const auto word : words) {
+        for (std::size_t byte = 0; byte < WORD_SIZE; ++byte) {
+          ++histograms[byte % WAYS][(word >> (8 * byte)) & 0xFF];
+        }
+      }
+    }
+    for (; position < segment.size(); ++position) { ++histograms[0][segment[position]]; }
+  }
+
+  void flushSegment() {
+    for (auto &histogram : histograms) {
+      std::ranges::transform(result, histogram, result.begin(), std::plus{});
+      histogram = {};
+    }
+    segmentBytes = 0;
+  }
+
+  std::array<std::array<uint32_t, ValueCount<T>>, WAYS> histograms{};
+  Histogram<T> result{};
+  std::size_t segmentBytes{};
+};
+}// namespace detail
+
+/**
+ * Histogram of byte data loaded a 64 bit word at a time with a shortcut for runs, @see detail::WordHistogram.
+ */
+template<std::integral T>
+requires(sizeof(T) == 1) Histogram<T> createHistogramWordWise(std::span<const uint8_t> data) {
+  auto histogram = detail::WordHistogram<T>{};
+  histogram.add(data);
+  return histogram.getResult();
+}
+
+/**
+ * Histogram of byte data counted on multiple threads, each thread counts a part of data using
+ * createHistogramWordWise.
+ * @param threadCount amount of threads used
+ */
+template<std::integral T>
+requires(sizeof(T) == 1) Histogram<T> createHistogramParallel(std::span<const uint8_t> data,
+                                                              std::size_t threadCount = defaultThreadCount()) {
+  threadCount = std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(1, data.size() / 4096));
+  auto partialHistograms = std::vector<Histogram<T>>(threadCount);
+  parallelFor(threadCount, [&](std::size_t index) {
+    const auto [begin, end] = splitRange(data.size(), threadCount, index);
+    partialHistograms[index] = createHistogramWordWise<T>(data.subspan(begin, end - begin));
+  });
+  auto result = Histogram<T>{};
+  for (const auto &histogram : partialHistograms) {
+    std::ranges::transform(result, histogram, result.begin(), std::plus{});
+  }
+  return result;
+}
+
+/**
+ * Create histogram of data with the fastest available kernel.
+ * @param data input data
+ * @return amount of occurrences of each symbol
+ */
+template<std::integral T>
+Histogram<T> createHistogram(const std::ranges::forward_range auto &data) {
+  using DataType = std::remove_cvref_t<decltype(data)>;
+  if constexpr (sizeof(T) == 1 && detail::ByteRange<DataType>) {
+    const auto bytes = std::span{reinterpret_cast<const uint8_t *>(std::ranges::data(data)), std::ranges::size(data)};
+    if (bytes.size() >= PARALLEL_HISTOGRAM_THRESHOLD) { return createHistogramParallel<T>(bytes); }
+    return createHistogramWordWise<T>(bytes);
+  } else {
+    return createHistogramMultiWay<T>(data);
+  }
+}
+
+namespace detail {
+/**
+ * Count residuals of model in a single pass over data, @see createHistogram.
+ * @details Residuals of each block stay in cache while they're counted by the fastest kernel, so data is read from
+ * memory only once.
+ * @param data input data, it isn't modified
+ * @param model model applied to data, it's left in the state after the last value
+ */
+template<std::integral T>
+Histogram<T> createResidualHistogram(const std::ranges::forward_range auto &data, Model<T> auto &model) {
+  auto byteHistogram = std::conditional_t<sizeof(T) == 1, WordHistogram<T>, std::monostate>{};
+  auto result = Histogram<T>{};
+  forEachResidualBlock<T>(data, model, [&](std::span<const T> residuals) {
+    if constexpr (sizeof(T) == 1) {
+      byteHistogram.add({reinterpret_cast<const uint8_t *>(residuals.data()), residuals.size()});
+    } else {
+      std::ranges::for_each(residuals,
+                            [&result](const auto value) { ++result[static_cast<std::make_unsigned_t<T>>(value)]; });
+    }
+  });
+  if constexpr (sizeof(T) == 1) { result = byteHistogram.getResult(); }
+  return result;
+}
+}// namespace detail
+
+/**
+ * Create histogram of residuals of model without storing them.
+ * @details Model is applied to each value as it's counted, so data is read only once and it isn't modified.
+ * @param data input data
+ * @param model model applied to data, its state after counting is discarded
+ * @return amount of occurrences of each residual
+ */
+template<std::integral T, typename M>
+requires Model<M, T> Histogram<T> createHistogram(const std::ranges::forward_range auto &data, M model) {
+  if constexpr (std::same_as<M, IdentityModel<T>>) {
+    return createHistogram<T>(data);
+  } else {
+    return detail::createResidualHistogram<T>(data, model);
+  }
+}
+
+/**
+ * Histogram of residuals of model of every rowStep-th row of image, starting with the first one.
+ * @details Only a fraction of data is read, so the result is an estimate. Each sampled row is transformed by its own
+ * copy of model, which sees the value preceding the row first, so residuals of models depending on the previous value
+ * match those of the whole image. Symbols missing from the sample are counted once, so that each of them gets a code
+ * even if it appears in rows which weren't sampled.
+ * @param image data viewed as rows
+ * @param rowStep distance between sampled rows, 1 for all rows
+ * @param model model applied to rows
+ * @return estimated amount of occurrences of each symbol, scaled down by about rowStep
+ */
+template<std::integral T, std::ranges::contiguous_range R, bool IsConst, typename M>
+requires Model<M, T> Histogram<T> createSampledHistogram(const View2D<R, IsConst> &image, std::size_t rowStep,
+                                                         const M &model) {
+  constexpr auto WAYS = std::size_t{4};
+  const auto values = std::span{std::ranges::data(image.getRange()), std::ranges::size(image.getRange())};
+  const auto width = std::max<std::size_t>(image.getWidth(), 1);
+  const auto rowDistance = std::max<std::size_t>(rowStep, 1) * width;
+  auto histograms = std::array<Histogram<T>, WAYS>{};
+  for (std::size_t rowStart = 0; rowStart < values.size(); rowStart += rowDistance) {
+    const auto row = values.subspan(rowStart, std::min(width, values.size() - rowStart));
+    auto rowModel = model;
+    // the value preceding the row is enough to warm up models depending on their neighbor
+    if (rowStart > 0) { [[maybe_unused]] const auto warmUp = rowModel.apply(values[rowStart - 1]); }
+    for (std::size_t i = 0; i < row.size(); ++i) {
+      ++histograms[i % WAYS][static_cast<std::make_unsigned_t<T>>(rowModel.apply(row[i]))];
+    }
+  }
+  auto result = detail::mergeHistograms<WAYS, T>(histograms);
+  std::ranges::replace(result, 0, 1);
+  return result;
+}
+
+/**
+ * Histogram of every rowStep-th row of image, @see createSampledHistogram above.
+ */
+template<std::integral T, std::ranges::contiguous_range R, bool IsConst>
+Histogram<T> createSampledHistogram(const View2D<R, IsConst> &image, std::size_t rowStep) {
+  return createSampledHistogram<T>(image, rowStep, IdentityModel<T>{});
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__HISTOGRAM_H
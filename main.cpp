@@ -17,11 +17,19 @@
 #include "fmt/core.h"
 #include "fmt/ostream.h"
 #include "magic_enum.hpp"
+#include "size_estimation.h"
 #include "spdlog/spdlog.h"
+#include "static_chunks_decoding.h"
+#include "static_chunks_encoding.h"
 #include "static_decoding.h"
+#include "static_dictionary.h"
 #include "static_encoding.h"
+#include <algorithm>
+#include <array>
+#include <filesystem>
 #include <optional>
 #include <span>
+#include <tuple>
 
 // ovladani logovani - zapisuje pouze do stdout
 #ifdef ENABLE_LOG
@@ -31,7 +39,7 @@
 #define ENABLE_LOG 0
 #endif
 
-enum class AppMode { Compress, Decompress };
+enum class AppMode { Compress, Decompress, Train, Estimate };
 enum class CompressionType { Static, Adaptive };
 
 struct AppSettings {
@@ -40,6 +48,13 @@ struct AppSettings {
   bool enableStatic;
   CompressionType compressionType;
   std::size_t imageWidth;
+  std::size_t maxCodeLength;
+  std::size_t chunkSize;
+  bool interleaveStreams;
+  std::size_t histogramSampleStep;
+  std::size_t rescaleThreshold;
+  std::size_t threadCount;
+  std::filesystem::path dictionaryPath;
   std::filesystem::path inputPath;
   std::filesystem::path outputPath;
 };
@@ -58,7 +73,10 @@ std::optional<argparse::ArgumentParser> parseArgs(std::span<char *> args) {
       .help("Adaptive scanning")
       .default_value(CompressionType::Static)
       .implicit_value(CompressionType::Adaptive);
-  parser.add_argument("-i").help("Path to input file").required().action(ValidPathCheckAction{PathType::File, true});
+  parser.add_argument("-i")
+      .help("Path to input file, a directory of sample files is accepted by --train")
+      .required()
+      .action(ValidPathCheckAction{PathType::FileOrDirectory, true});
   parser.add_argument("-o").help("Path to output file").required().action(ValidPathCheckAction{PathType::File, false});
   parser.add_argument("--static").help("Static huffman").default_value(false).implicit_value(true);
   parser.add_argument("-w").help("Input image width").required().action([](const std::string &value) {
@@ -66,6 +84,74 @@ std::optional<argparse::ArgumentParser> parseArgs(std::span<char *> args) {
     if (result < 1) { throw std::runtime_error(fmt::format("Invalid value for image width: '{}'", result)); }
     return static_cast<std::size_t>(result);
   });
+  parser.add_argument("--max-code-length")
+      .help("Maximum code length in bits for static huffman, 0 for unlimited")
+      .default_value(std::size_t{0})
+      .action([](const std::string &value) {
+        const auto result = std::stoi(value);
+        if (result != 0 && (result < 8 || result > 64)) {
+          throw std::runtime_error(fmt::format("Invalid value for maximum code length: '{}'", result));
+        }
+        return static_cast<std::size_t>(result);
+      });
+  parser.add_argument("--interleave")
+      .help("Encode static huffman in 4 interleaved streams for faster decoding")
+      .default_value(false)
+      .implicit_value(true);
+  parser.add_argument("--histogram-sample-step")
+      .help("Build static huffman codes from every n-th row of input image, 1 for all rows")
+      .default_value(std::size_t{1})
+      .action([](const std::string &value) {
+        const auto result = std::stoi(value);
+        if (result < 1) {
+          throw std::runtime_error(fmt::format("Invalid value for histogram sample step: '{}'", result));
+        }
+        return static_cast<std::size_t>(result);
+      });
+  parser.add_argument("--rescale-threshold")
+      .help("Halve weights of adaptive huffman tree when they sum up to given value, 0 to never halve them, the same "
+            "value has to be used for decompression")
+      .default_value(std::size_t{0})
+      .action([](const std::string &value) {
+        const auto result = std::stoll(value);
+        // halved weights of all symbols have to stay below the threshold
+        if (result != 0 && result < 512) {
+          throw std::runtime_error(fmt::format("Invalid value for rescale threshold: '{}'", result));
+        }
+        return static_cast<std::size_t>(result);
+      });
+  parser.add_argument("--threads")
+      .help("Amount of threads for static huffman, 0 for default: all threads for chunks and large streams when "
+            "decoding, a single thread when encoding a single stream")
+      .default_value(std::size_t{0})
+      .action([](const std::string &value) {
+        const auto result = std::stoi(value);
+        if (result < 0) { throw std::runtime_error(fmt::format("Invalid value for thread count: '{}'", result)); }
+        return static_cast<std::size_t>(result);
+      });
+  parser.add_argument("--train")
+      .help("Train static huffman dictionary on input file or all files of input directory and store it to output file")
+      .default_value(false)
+      .implicit_value(true);
+  parser.add_argument("--estimate")
+      .help("Estimate encoded size of input file for each mode without encoding it and store the estimates to output "
+            "file, static sizes are exact for a single stream with --max-code-length")
+      .default_value(false)
+      .implicit_value(true);
+  parser.add_argument("--dictionary")
+      .help("Path to static huffman dictionary created by --train")
+      .default_value(std::filesystem::path{})
+      .action(ValidPathCheckAction{PathType::File, true});
+  parser.add_argument("--chunk-size")
+      .help("Encode static huffman in independent chunks of given amount of pixels, 0 for a single chunk")
+      .default_value(std::size_t{0})
+      .action([](const std::string &value) {
+        const auto result = std::stoll(value);
+        if (result < 0 || result > UINT32_MAX) {
+          throw std::runtime_error(fmt::format("Invalid value for chunk size: '{}'", result));
+        }
+        return static_cast<std::size_t>(result);
+      });
 
   try {
     parser.parse_args(args.size(), args.data());
@@ -77,41 +163,120 @@ std::optional<argparse::ArgumentParser> parseArgs(std::span<char *> args) {
   return parser;
 }
 
-std::function<std::vector<uint8_t>(std::vector<uint8_t> &&)> getEncodeFnc(const AppSettings &settings) {
+using Dictionary = pf::kko::StaticDictionary<uint8_t>;
+
+/**
+ * Read dictionary from file, if its path is set.
+ * @return unexpected when dictionary file is malformed, std::nullopt when no path is set
+ */
+tl::expected<std::optional<Dictionary>, std::string> readDictionary(const AppSettings &settings) {
+  if (settings.dictionaryPath.empty()) { return std::nullopt; }
+  const auto data = pf::kko::RawGrayscaleImageDataReader{settings.dictionaryPath, 1}.readAllRaw();
+  return pf::kko::readStaticDictionary<uint8_t>(data).map([](auto &&dictionary) {
+    return std::optional<Dictionary>{std::forward<decltype(dictionary)>(dictionary)};
+  });
+}
+
+/**
+ * Read samples for training of dictionary.
+ * @return content of input file, or content of each file of input directory ordered by path
+ */
+std::vector<std::vector<uint8_t>> readTrainingSamples(const AppSettings &settings) {
+  if (!std::filesystem::is_directory(settings.inputPath)) {
+    return {pf::kko::RawGrayscaleImageDataReader{settings.inputPath, settings.imageWidth}.readAllRaw()};
+  }
+  auto paths = std::vector<std::filesystem::path>{};
+  for (const auto &entry : std::filesystem::directory_iterator{settings.inputPath}) {
+    if (entry.is_regular_file()) { paths.emplace_back(entry.path()); }
+  }
+  std::ranges::sort(paths);
+  auto samples = std::vector<std::vector<uint8_t>>{};
+  std::ranges::transform(paths, std::back_inserter(samples), [&settings](const auto &path) {
+    return pf::kko::RawGrayscaleImageDataReader{path, settings.imageWidth}.readAllRaw();
+  });
+  return samples;
+}
+
+std::function<void(std::vector<uint8_t> &&, std::ostream &)>
+getEncodeFnc(const AppSettings &settings, const std::optional<Dictionary> &dictionary) {
   if (settings.enableStatic) {
+    if (dictionary.has_value()) {
+      if (settings.enableModel) {
+        return [dictionary = *dictionary](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeStaticWithDictionary<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                                       dictionary, sink);
+        };
+      } else {
+        return [dictionary = *dictionary](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeStaticWithDictionary<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, dictionary,
+                                                       sink);
+        };
+      }
+    }
+    const auto options = pf::kko::StaticEncodingOptions{.maxCodeLength = settings.maxCodeLength,
+                                                        .threadCount = settings.threadCount,
+                                                        .interleaveStreams = settings.interleaveStreams,
+                                                        .histogramSampleStep = settings.histogramSampleStep,
+                                                        .histogramSampleRowWidth = settings.imageWidth};
+    if (const auto chunkSize = settings.chunkSize; chunkSize != 0) {
+      if (settings.enableModel) {
+        return [options, chunkSize](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeStaticChunks<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                               chunkSize, sink, options);
+        };
+      } else {
+        return [options, chunkSize](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeStaticChunks<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, chunkSize, sink,
+                                               options);
+        };
+      }
+    }
     if (settings.enableModel) {
-      return [](auto &&data) {
-        return pf::kko::encodeStatic<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{});
+      return [options](auto &&data, auto &output) {
+        auto sink = pf::kko::StreamSink{output};
+        pf::kko::encodeStatic<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{}, sink, options);
       };
     } else {
-      return [](auto &&data) {
-        return pf::kko::encodeStatic<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{});
+      return [options](auto &&data, auto &output) {
+        auto sink = pf::kko::StreamSink{output};
+        pf::kko::encodeStatic<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, sink, options);
       };
     }
   }
+  const auto rescaleThreshold = settings.rescaleThreshold;
   switch (settings.compressionType) {
     case CompressionType::Static: {
       if (settings.enableModel) {
-        return [](auto &&data) {
-          return pf::kko::encodeAdaptive<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{});
+        return [rescaleThreshold](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeAdaptive<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{}, sink,
+                                           rescaleThreshold);
         };
       } else {
-        return [](auto &&data) {
-          return pf::kko::encodeAdaptive<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{});
+        return [rescaleThreshold](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeAdaptive<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, sink, rescaleThreshold);
         };
       }
     }
     case CompressionType::Adaptive: {
       const auto imgWidth = settings.imageWidth;
       if (settings.enableModel) {
-        return [imgWidth](auto &&data) {
-          return pf::kko::encodeImageAdaptiveBlocks<uint8_t>(std::move(data), imgWidth,
-                                                             pf::kko::NeighborDifferenceModel<uint8_t>{});
+        return [imgWidth, rescaleThreshold](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeImageAdaptiveBlocks<uint8_t>(std::move(data), imgWidth,
+                                                      pf::kko::NeighborDifferenceModel<uint8_t>{}, sink,
+                                                      rescaleThreshold);
         };
       } else {
-        return [imgWidth](auto &&data) {
-          return pf::kko::encodeImageAdaptiveBlocks<uint8_t>(std::move(data), imgWidth,
-                                                             pf::kko::IdentityModel<uint8_t>{});
+        return [imgWidth, rescaleThreshold](auto &&data, auto &output) {
+          auto sink = pf::kko::StreamSink{output};
+          pf::kko::encodeImageAdaptiveBlocks<uint8_t>(std::move(data), imgWidth, pf::kko::IdentityModel<uint8_t>{},
+                                                      sink, rescaleThreshold);
         };
       }
     }
@@ -120,39 +285,70 @@ std::function<std::vector<uint8_t>(std::vector<uint8_t> &&)> getEncodeFnc(const
 }
 
 std::function<tl::expected<std::vector<uint8_t>, std::string>(std::vector<uint8_t> &&)>
-getDecodeFnc(const AppSettings &settings) {
+getDecodeFnc(const AppSettings &settings, const std::optional<Dictionary> &dictionary) {
   if (settings.enableStatic) {
+    if (dictionary.has_value()) {
+      if (settings.enableModel) {
+        return [dictionary = *dictionary](auto &&data) {
+          return pf::kko::decodeStaticWithDictionary<uint8_t>(std::move(data), dictionary,
+                                                              pf::kko::NeighborDifferenceModel<uint8_t>{});
+        };
+      } else {
+        return [dictionary = *dictionary](auto &&data) {
+          return pf::kko::decodeStaticWithDictionary<uint8_t>(std::move(data), dictionary,
+                                                              pf::kko::IdentityModel<uint8_t>{});
+        };
+      }
+    }
+    const auto threadCount = settings.threadCount;
+    if (settings.chunkSize != 0) {
+      if (settings.enableModel) {
+        return [threadCount](auto &&data) {
+          return pf::kko::decodeStaticChunks<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                                      threadCount);
+        };
+      } else {
+        return [threadCount](auto &&data) {
+          return pf::kko::decodeStaticChunks<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, threadCount);
+        };
+      }
+    }
     if (settings.enableModel) {
-      return [](auto &&data) {
-        return pf::kko::decodeStatic<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{});
+      return [threadCount](auto &&data) {
+        return pf::kko::decodeStatic<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                              threadCount);
       };
     } else {
-      return [](auto &&data) {
-        return pf::kko::decodeStatic<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{});
+      return [threadCount](auto &&data) {
+        return pf::kko::decodeStatic<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, threadCount);
       };
     }
   }
+  const auto rescaleThreshold = settings.rescaleThreshold;
   switch (settings.compressionType) {
     case CompressionType::Static: {
       if (settings.enableModel) {
-        return [](auto &&data) {
-          return pf::kko::decodeAdaptive<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{});
+        return [rescaleThreshold](auto &&data) {
+          return pf::kko::decodeAdaptive<uint8_t>(std::move(data), pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                                  rescaleThreshold);
         };
       } else {
-        return [](auto &&data) {
-          return pf::kko::decodeAdaptive<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{});
+        return [rescaleThreshold](auto &&data) {
+          return pf::kko::decodeAdaptive<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{}, rescaleThreshold);
         };
       }
     }
     case CompressionType::Adaptive: {
       if (settings.enableModel) {
-        return [](auto &&data) {
+        return [rescaleThreshold](auto &&data) {
           return pf::kko::decodeImageAdaptiveBlocks<uint8_t>(std::move(data),
-                                                             pf::kko::NeighborDifferenceModel<uint8_t>{});
+                                                             pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                                             rescaleThreshold);
         };
       } else {
-        return [](auto &&data) {
-          return pf::kko::decodeImageAdaptiveBlocks<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{});
+        return [rescaleThreshold](auto &&data) {
+          return pf::kko::decodeImageAdaptiveBlocks<uint8_t>(std::move(data), pf::kko::IdentityModel<uint8_t>{},
+                                                             rescaleThreshold);
         };
       }
     }
@@ -160,6 +356,37 @@ getDecodeFnc(const AppSettings &settings) {
   throw "Only 'cause -Werror=return-type doesn't recognize, that this function always returns through switch";
 }
 
+/**
+ * Write estimated encoded size of data for each mode, one line per mode: name, size in bytes and whether the size is
+ * exact or approximate. The last line names the mode with the smallest size.
+ * @param data input image
+ * @param settings settings of the application
+ * @param output destination of estimates
+ */
+void writeSizeEstimates(const std::vector<uint8_t> &data, const AppSettings &settings, std::ostream &output) {
+  using namespace pf::kko;
+  const auto rawHistogram = createHistogram<uint8_t>(data, IdentityModel<uint8_t>{});
+  const auto modelHistogram = createHistogram<uint8_t>(data, NeighborDifferenceModel<uint8_t>{});
+  const auto estimates = std::array{
+      std::tuple{"static", estimateStaticSize<uint8_t>(rawHistogram, settings.maxCodeLength), true},
+      std::tuple{"static-model", estimateStaticSize<uint8_t>(modelHistogram, settings.maxCodeLength), true},
+      std::tuple{"adaptive", estimateAdaptiveSize<uint8_t>(rawHistogram), false},
+      std::tuple{"adaptive-model", estimateAdaptiveSize<uint8_t>(modelHistogram), false},
+      std::tuple{"adaptive-blocks",
+                 estimateImageAdaptiveBlocksSize<uint8_t>(data, settings.imageWidth, IdentityModel<uint8_t>{}), false},
+      std::tuple{"adaptive-blocks-model",
+                 estimateImageAdaptiveBlocksSize<uint8_t>(data, settings.imageWidth,
+                                                          NeighborDifferenceModel<uint8_t>{}),
+                 false}};
+  std::ranges::for_each(estimates, [&output](const auto &estimate) {
+    const auto &[name, size, isExact] = estimate;
+    fmt::print(output, "{} {} {}\n", name, size, isExact ? "exact" : "approximate");
+  });
+  const auto &best =
+      *std::ranges::min_element(estimates, {}, [](const auto &estimate) { return std::get<1>(estimate); });
+  fmt::print(output, "best {}\n", std::get<0>(best));
+}
+
 int main(int argc, char **argv) {
   spdlog::set_pattern("[%H:%M:%S.%f] [%l] [thread %t] %v");
 #if ENABLE_LOG == 0
@@ -174,29 +401,53 @@ int main(int argc, char **argv) {
     return 0;
   }
 
-  const auto settings = AppSettings{.mode = args->get<bool>("-c") ? AppMode::Compress : AppMode::Decompress,
+  const auto mode = args->get<bool>("--train") ? AppMode::Train
+      : args->get<bool>("--estimate")          ? AppMode::Estimate
+      : args->get<bool>("-c")                  ? AppMode::Compress
+                                               : AppMode::Decompress;
+  const auto settings = AppSettings{.mode = mode,
                                     .enableModel = args->get<bool>("-m"),
                                     .enableStatic = args->get<bool>("--static"),
                                     .compressionType = args->get<CompressionType>("-a"),
                                     .imageWidth = args->get<std::size_t>("-w"),
+                                    .maxCodeLength = args->get<std::size_t>("--max-code-length"),
+                                    .chunkSize = args->get<std::size_t>("--chunk-size"),
+                                    .interleaveStreams = args->get<bool>("--interleave"),
+                                    .histogramSampleStep = args->get<std::size_t>("--histogram-sample-step"),
+                                    .rescaleThreshold = args->get<std::size_t>("--rescale-threshold"),
+                                    .threadCount = args->get<std::size_t>("--threads"),
+                                    .dictionaryPath = args->get<std::filesystem::path>("--dictionary"),
                                     .inputPath = args->get<std::filesystem::path>("-i"),
                                     .outputPath = args->get<std::filesystem::path>("-o")};
 
   spdlog::info("Input file: {}, image width: {}, mode: {}, using model: {}", settings.inputPath.string(),
                settings.imageWidth, magic_enum::enum_name(settings.mode), settings.enableModel);
 
-  auto data = pf::kko::RawGrayscaleImageDataReader{settings.inputPath, settings.imageWidth}.readAllRaw();
+  if (settings.mode != AppMode::Train && std::filesystem::is_directory(settings.inputPath)) {
+    spdlog::error("Input directory is accepted only by --train");
+    fmt::print(stderr, "Input directory is accepted only by --train");
+    return 0;
+  }
+  auto data = settings.mode == AppMode::Train
+      ? std::vector<uint8_t>{}
+      : pf::kko::RawGrayscaleImageDataReader{settings.inputPath, settings.imageWidth}.readAllRaw();
   spdlog::trace("Read data, total length: {}[B]", data.size());
 
+  const auto dictionary = readDictionary(settings);
+  if (!dictionary.has_value()) {
+    spdlog::error("Error while reading dictionary: {}", dictionary.error());
+    fmt::print(stderr, "Error while reading dictionary: {}", dictionary.error());
+    return 0;
+  }
+
   auto outputStream = std::ofstream(settings.outputPath, std::ios::binary);
 
   switch (settings.mode) {
     case AppMode::Compress: {
-      const auto encodedData = getEncodeFnc(settings)(std::move(data));
-      outputStream.write(reinterpret_cast<const char *>(encodedData.data()), encodedData.size());
+      getEncodeFnc(settings, *dictionary)(std::move(data), outputStream);
     } break;
     case AppMode::Decompress: {
-      const auto decodedData = getDecodeFnc(settings)(std::move(data));
+      const auto decodedData = getDecodeFnc(settings, *dictionary)(std::move(data));
       if (decodedData.has_value()) {
         outputStream.write(reinterpret_cast<const char *>(decodedData->data()), decodedData->size());
       } else {
@@ -204,6 +455,32 @@ int main(int argc, char **argv) {
         fmt::print(stderr, "Error while decoding: {}", decodedData.error());
       }
     } break;
+    case AppMode::Train: {
+      const auto samples = readTrainingSamples(settings);
+      if (samples.empty()) {
+        spdlog::error("No samples to train dictionary on");
+        fmt::print(stderr, "No samples to train dictionary on");
+        return 0;
+      }
+      spdlog::trace("Read {} samples", samples.size());
+      const auto trainedDictionary =
+          settings.enableModel
+              ? pf::kko::trainStaticDictionary<uint8_t>(samples, pf::kko::NeighborDifferenceModel<uint8_t>{},
+                                                        settings.maxCodeLength)
+              : pf::kko::trainStaticDictionary<uint8_t>(samples, pf::kko::IdentityModel<uint8_t>{},
+                                                        settings.maxCodeLength);
+      if (!trainedDictionary.has_value()) {
+        spdlog::error("Error while training dictionary: {}", trainedDictionary.error());
+        fmt::print(stderr, "Error while training dictionary: {}", trainedDictionary.error());
+        return 0;
+      }
+      const auto serialized = trainedDictionary->serialize();
+      outputStream.write(reinterpret_cast<const char *>(serialized.data()), serialized.size());
+      spdlog::info("Trained dictionary {:08x}", trainedDictionary->getId());
+    } break;
+    case AppMode::Estimate: {
+      writeSizeEstimates(data, settings, outputStream);
+    } break;
   }
 
   return 0;
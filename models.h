@@ -8,7 +8,12 @@
 #ifndef HUFF_CODEC__MODELS_H
 #define HUFF_CODEC__MODELS_H
 
+#include <algorithm>
+#include <array>
 #include <concepts>
+#include <iterator>
+#include <ranges>
+#include <span>
 #include <utility>
 
 namespace pf::kko {
@@ -24,6 +29,7 @@ template<typename T>
 struct IdentityModel {
   [[nodiscard]] T apply(const T &value) { return value; }
   [[nodiscard]] T revert(const T &value) { return value; }
+  void apply(std::span<const T> values, std::span<T> residuals) { std::ranges::copy(values, residuals.begin()); }
 };
 
 template<typename T>
@@ -39,6 +45,17 @@ class NeighborDifferenceModel {
     lastVal = result;
     return result;
   }
+  /**
+   * Apply to a block of values at once, each residual depends only on input values, so the loop is vectorized.
+   * @param values input values
+   * @param residuals destination of residuals, it has to be at least as large as values
+   */
+  void apply(std::span<const T> values, std::span<T> residuals) {
+    if (values.empty()) { return; }
+    residuals[0] = static_cast<T>(values[0] - lastVal);
+    for (std::size_t i = 1; i < values.size(); ++i) { residuals[i] = static_cast<T>(values[i] - values[i - 1]); }
+    lastVal = values.back();
+  }
 
  private:
   T lastVal{};
@@ -52,6 +69,51 @@ auto makeApplyLambda(Model<T> auto &&model) {
   return [m = std::forward<decltype(model)>(model)](auto &value) mutable { return m.apply(value); };
 }
 
+/**
+ * Apply model to a block of values, using block apply of the model when it provides one.
+ * @param model
+ * @param values input values
+ * @param residuals destination of residuals, it has to be at least as large as values
+ */
+template<typename T>
+void applyModel(Model<T> auto &model, std::span<const T> values, std::span<T> residuals) {
+  if constexpr (requires { model.apply(values, residuals); }) {
+    model.apply(values, residuals);
+  } else {
+    std::ranges::transform(values, residuals.begin(), [&model](const T &value) { return model.apply(value); });
+  }
+}
+
+/**
+ * Apply model to data a block at a time and pass each block of residuals to a callback.
+ * @details Blocks are small enough to stay in cache, so residuals can be consumed without being stored in memory.
+ * @param data input data, it isn't modified
+ * @param model
+ * @param callback called with a span of residuals of each block
+ */
+template<typename T, std::size_t BlockSize = 4096>
+void forEachResidualBlock(const std::ranges::forward_range auto &data, Model<T> auto &model, auto &&callback) {
+  auto values = std::array<T, BlockSize>{};
+  auto residuals = std::array<T, BlockSize>{};
+  auto iter = std::ranges::begin(data);
+  const auto end = std::ranges::end(data);
+  while (iter != end) {
+    const auto blockEnd = std::ranges::next(iter, static_cast<std::ptrdiff_t>(BlockSize), end);
+    auto blockValues = std::span<const T>{};
+    if constexpr (std::contiguous_iterator<decltype(iter)>
+                  && std::same_as<std::iter_value_t<decltype(iter)>, T>) {
+      blockValues = std::span<const T>{std::to_address(iter), static_cast<std::size_t>(blockEnd - iter)};
+    } else {
+      const auto copyEnd = std::ranges::copy(iter, blockEnd, values.begin()).out;
+      blockValues = std::span<const T>{values.begin(), copyEnd};
+    }
+    const auto blockResiduals = std::span<T>{residuals}.first(blockValues.size());
+    applyModel<T>(model, blockValues, blockResiduals);
+    callback(std::span<const T>{blockResiduals});
+    iter = blockEnd;
+  }
+}
+
 template<typename T>
 auto makeRevertLambda(Model<T> auto &&model) {
   return [m = std::forward<decltype(model)>(model)](auto &value) mutable { return m.revert(value); };
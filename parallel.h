@@ -0,0 +1,63 @@
+/**
+ * @name parallel.h
+ * @brief helpers for running work on multiple threads
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__PARALLEL_H
+#define HUFF_CODEC__PARALLEL_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace pf::kko {
+/**
+ * @return amount of threads, which can run concurrently, 1 at least
+ */
+inline std::size_t defaultThreadCount() { return std::max(1u, std::thread::hardware_concurrency()); }
+
+/**
+ * Call fnc(index) for each index in [0, count), every call runs on its own thread. Index 0 runs on the calling thread.
+ * @details The function returns after all calls have finished. An exception thrown by a call is caught on its thread
+ * and the exception of the call with the lowest index is rethrown to the caller once all calls have finished.
+ * @param count amount of calls
+ * @param fnc function to call
+ */
+inline void parallelFor(std::size_t count, std::invocable<std::size_t> auto &&fnc) {
+  if (count == 0) { return; }
+  auto exceptions = std::vector<std::exception_ptr>(count);
+  const auto call = [&fnc, &exceptions](std::size_t index) {
+    try {
+      fnc(index);
+    } catch (...) { exceptions[index] = std::current_exception(); }
+  };
+  {
+    auto threads = std::vector<std::jthread>{};
+    threads.reserve(count - 1);
+    for (std::size_t i = 1; i < count; ++i) { threads.emplace_back(call, i); }
+    call(std::size_t{0});
+  }
+  if (const auto exception = std::ranges::find_if(exceptions, [](const auto &e) { return e != nullptr; });
+      exception != exceptions.end()) {
+    std::rethrow_exception(*exception);
+  }
+}
+
+/**
+ * Split [0, size) into count ranges of similar size.
+ * @return bounds of index-th range
+ */
+constexpr std::pair<std::size_t, std::size_t> splitRange(std::size_t size, std::size_t count, std::size_t index) {
+  const auto partSize = size / count;
+  const auto remainder = size % count;
+  const auto begin = index * partSize + std::min(index, remainder);
+  return {begin, begin + partSize + (index < remainder ? 1 : 0)};
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__PARALLEL_H
@@ -0,0 +1,108 @@
+/**
+ * @name size_estimation.h
+ * @brief prediction of encoded data size without encoding the data
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__SIZE_ESTIMATION_H
+#define HUFF_CODEC__SIZE_ESTIMATION_H
+
+#include "AdaptiveImageScanner.h"
+#include "View2D.h"
+#include "histogram.h"
+#include "models.h"
+#include "static_common.h"
+#include "static_encoding.h"
+#include <algorithm>
+#include <concepts>
+#include <ranges>
+#include <utility>
+
+namespace pf::kko {
+
+namespace detail {
+/**
+ * Bits taken by adaptive codes of data with given histogram, if each symbol kept the length of its static code.
+ * @details NYT node has zero weight, so its code is about as long as the longest one. Each new symbol costs NYT code
+ * and 9 bits of its value.
+ * @return bits of codes and length of NYT code at the end of data
+ */
+template<std::integral T>
+std::pair<std::size_t, std::size_t> estimateAdaptiveBits(const Histogram<T> &histogram) {
+  const auto symbolCount = static_cast<std::size_t>(std::ranges::count_if(histogram, [](const auto count) {
+    return count > 0;
+  }));
+  if (symbolCount == 0) { return {0, 0}; }
+  const auto symbolCodes = buildCanonicalCodes<T>(histogram);
+  const auto nytCodeLength = symbolCodes.back().second.size();
+  const auto newSymbolBits = symbolCount * (nytCodeLength + 9);
+  return {countPayloadBits(histogram, createCodeTable(symbolCodes)) + newSymbolBits, nytCodeLength};
+}
+}// namespace detail
+
+/**
+ * Exact size of data encoded via encodeStatic without interleaved streams.
+ * @details Size consists of the header, which depends only on code lengths, and the payload, which is the sum of code
+ * lengths weighted by histogram. Data itself isn't needed.
+ * @param histogram histogram of residuals of model, as created by createHistogram
+ * @param maxCodeLength maximum length of a code in bits, 0 for unlimited
+ * @throws std::invalid_argument when maxCodeLength is too small to encode all symbols present in histogram
+ * @return size of encoded data in bytes
+ */
+template<std::integral T>
+std::size_t estimateStaticSize(const Histogram<T> &histogram, std::size_t maxCodeLength = 0) {
+  const auto symbolCodes = buildCanonicalCodes<T>(histogram, maxCodeLength);
+  if (symbolCodes.empty()) { return 0; }
+  const auto minLength = symbolCodes.front().second.size();
+  const auto maxLength = symbolCodes.back().second.size();
+  // code length info, padding info, amount of codes of each length and symbols
+  const auto headerSize = 2 + (maxLength - minLength + 1) + symbolCodes.size();
+  const auto payloadBitSize = detail::countPayloadBits(histogram, detail::createCodeTable(symbolCodes));
+  return headerSize + (payloadBitSize + 7) / 8;
+}
+
+/**
+ * Approximate size of data encoded via encodeAdaptive.
+ * @details Adaptive codes are expected to be as long as static codes built from the whole histogram, with each
+ * symbol's first occurrence costing the code of NYT node and 9 bits of its value. Stream is ended by NYT code.
+ * @param histogram histogram of residuals of model
+ * @return approximate size of encoded data in bytes
+ */
+template<std::integral T>
+std::size_t estimateAdaptiveSize(const Histogram<T> &histogram) {
+  const auto [payloadBitSize, eofBitSize] = detail::estimateAdaptiveBits<T>(histogram);
+  return (payloadBitSize + eofBitSize + 7) / 8;
+}
+
+/**
+ * Approximate size of image encoded via encodeImageAdaptiveBlocks.
+ * @details Image is scanned by the same AdaptiveImageScanner as during encoding, so scan methods of blocks and the
+ * symbols they produce are the same. Only the tree updates and the output are skipped. Symbols of all blocks are
+ * estimated as by estimateAdaptiveSize, blocks add their 3 bit headers to it.
+ * @param data image data, it isn't modified
+ * @param imageWidth width of image
+ * @param model model used during encoding
+ * @return approximate size of encoded data in bytes
+ */
+template<std::integral T>
+std::size_t estimateImageAdaptiveBlocksSize(const std::ranges::contiguous_range auto &data, std::size_t imageWidth,
+                                            Model<T> auto &&model) {
+  auto view = makeView2D<true>(data, imageWidth);
+  auto scanner = AdaptiveImageScanner(view, {8, 8}, NeighborDifferenceScorer{}, std::forward<decltype(model)>(model));
+  auto histogram = Histogram<T>{};
+  auto blockCount = std::size_t{};
+  for (auto &block : scanner) {
+    ++blockCount;
+    for (auto symbol : block) { ++histogram[static_cast<std::make_unsigned_t<T>>(symbol)]; }
+  }
+  // image size, block size
+  constexpr auto imageHeaderBitSize = std::size_t{2 * 16 + 2 * 8};
+  // block headers and end marker
+  const auto blockHeaderBitSize = (blockCount + 1) * 3;
+  const auto payloadBitSize = detail::estimateAdaptiveBits<T>(histogram).first;
+  return (imageHeaderBitSize + blockHeaderBitSize + payloadBitSize + 7) / 8;
+}
+
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__SIZE_ESTIMATION_H
@@ -0,0 +1,206 @@
+/**
+ * @name static_batch_decoding.h
+ * @brief static huffman decoding of many independent streams on a single thread
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__STATIC_BATCH_DECODING_H
+#define HUFF_CODEC__STATIC_BATCH_DECODING_H
+
+#include "BitReader.h"
+#include "DecodingTable.h"
+#include "models.h"
+#include "static_decoding.h"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <fmt/core.h>
+#include <functional>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <tl/expected.hpp>
+#include <vector>
+
+namespace pf::kko {
+
+/**
+ * Amount of streams decodeStaticMany decodes at the same time.
+ */
+constexpr auto BATCH_DECODE_STREAM_COUNT = std::size_t{4};
+/**
+ * Streams with payload at least this large in bytes are decoded by decodeStaticMany on their own with the
+ * multi-symbol table. Building the table would take longer than decoding a smaller stream.
+ */
+constexpr auto BATCH_MULTI_SYMBOL_PAYLOAD_SIZE = std::size_t{4 * 1024};
+
+namespace detail {
+/**
+ * Small stream being decoded by decodeStaticMany a symbol per lookup.
+ */
+template<std::integral T>
+struct BatchStream {
+  std::size_t index{};
+  std::optional<DecodingTable> table;
+  BitReader reader{std::span<const uint8_t>{}};
+  T *output{};
+  T *outputEnd{};
+  /**
+   * False when an invalid code was met.
+   */
+  bool isValid{};
+
+  [[nodiscard]] std::size_t remaining() const { return static_cast<std::size_t>(outputEnd - output); }
+  /**
+   * Decode a single symbol.
+   * @return false if the input contains invalid code
+   */
+  bool decodeSymbol() {
+    isValid = table->decode(reader, *output);
+    output += isValid;
+    return isValid;
+  }
+};
+
+/**
+ * Decode the rest of stream and check that it contains exactly as many symbols as its output.
+ * @return unexpected when input is malformed or contains a different amount of symbols than output
+ */
+template<std::integral T>
+tl::expected<void, std::string> closeBatchStream(BatchStream<T> &stream) {
+  if (!stream.isValid) { return tl::make_unexpected("Invalid code in input data"); }
+  const auto decoded = decodeStaticSymbols(stream.reader, *stream.table, std::span<T>{stream.output, stream.outputEnd});
+  if (!decoded.has_value()) { return decoded; }
+  if (stream.reader.position() != stream.reader.size()) {
+    return tl::make_unexpected("Output size doesn't match data");
+  }
+  return {};
+}
+/**
+ * Prepare stream for decoding, interleaved and large streams are decoded right away.
+ * @param input encoded stream
+ * @param output destination of decoded symbols, its size has to match amount of symbols in input
+ * @param stream state of decoding to set up
+ * @return unexpected when input is malformed, false when stream has already been decoded
+ */
+template<std::integral T>
+tl::expected<bool, std::string> openBatchStream(std::span<const uint8_t> input, std::span<T> output,
+                                                BatchStream<T> &stream) {
+  const auto header = readStaticHeader(input);
+  if (!header.has_value()) { return tl::make_unexpected(header.error()); }
+  const auto payload = input.subspan(header->payloadOffset);
+  const auto isDecodedAlone = header->isInterleaved || payload.size() >= BATCH_MULTI_SYMBOL_PAYLOAD_SIZE;
+  try {
+    stream.table.emplace(header->lengthCounts, header->symbols, isDecodedAlone);
+  } catch (const std::invalid_argument &e) { return tl::make_unexpected(e.what()); }
+
+  if (header->isInterleaved) {
+    const auto decoded = decodeStaticInterleaved(payload, *stream.table, output);
+    if (!decoded.has_value()) { return tl::make_unexpected(decoded.error()); }
+    return false;
+  }
+  if (header->padding > payload.size() * 8) { return tl::make_unexpected("File size doesn't match data"); }
+  stream.reader = BitReader{payload, payload.size() * 8 - header->padding};
+  stream.output = output.data();
+  stream.outputEnd = output.data() + output.size();
+  stream.isValid = true;
+  if (isDecodedAlone) {
+    const auto decoded = closeBatchStream(stream);
+    if (!decoded.has_value()) { return tl::make_unexpected(decoded.error()); }
+    return false;
+  }
+  return true;
+}
+
+}// namespace detail
+
+/**
+ * Decode many streams encoded via @see encodeStatic<T> function into outputs provided by caller.
+ * @details A single stream is decoded one lookup after another, each waiting for the previous one to find where the
+ * next code starts. BATCH_DECODE_STREAM_COUNT small streams are decoded in a single loop instead, a symbol of each of
+ * them in turn, so that the processor can work on their independent lookups at the same time. A finished stream is
+ * replaced by the next one. Decoding of a small stream is dominated by building its multi-symbol table, so streams
+ * smaller than BATCH_MULTI_SYMBOL_PAYLOAD_SIZE are decoded a symbol per lookup without it, the interleaving hides
+ * latency of their lookups instead. Larger and interleaved streams are decoded on their own. All streams are decoded
+ * even if some of them fail.
+ * @param inputs encoded streams
+ * @param outputs destinations of decoded streams, each of them has to be as large as the amount of symbols encoded in
+ * the corresponding input
+ * @param model model used during encoding, each stream is reverted by its own copy
+ * @return unexpected with the error of the first failed stream, outputs of the other streams are decoded
+ */
+template<std::integral T>
+tl::expected<void, std::string> decodeStaticMany(std::span<const std::span<const uint8_t>> inputs,
+                                                 std::span<const std::span<T>> outputs, Model<T> auto &&model) {
+  constexpr auto STREAM_COUNT = BATCH_DECODE_STREAM_COUNT;
+  if (inputs.size() != outputs.size()) { return tl::make_unexpected("Amount of outputs doesn't match inputs"); }
+
+  auto errors = std::vector<std::optional<std::string>>(inputs.size());
+  const auto revert = [&](std::size_t index) {
+    std::ranges::transform(outputs[index], outputs[index].begin(),
+                           makeRevertLambda<T>(std::remove_cvref_t<decltype(model)>{model}));
+  };
+  auto nextIndex = std::size_t{};
+  // set up the next stream to be decoded in the loop, false when there is none left
+  const auto open = [&](detail::BatchStream<T> &stream) {
+    for (; nextIndex < inputs.size(); ++nextIndex) {
+      const auto opened = detail::openBatchStream(inputs[nextIndex], outputs[nextIndex], stream);
+      if (!opened.has_value()) {
+        errors[nextIndex] = opened.error();
+      } else if (*opened) {
+        stream.index = nextIndex++;
+        return true;
+      } else {
+        revert(nextIndex);
+      }
+    }
+    return false;
+  };
+  const auto close = [&](detail::BatchStream<T> &stream) {
+    const auto closed = detail::closeBatchStream(stream);
+    if (closed.has_value()) {
+      revert(stream.index);
+    } else {
+      errors[stream.index] = closed.error();
+    }
+  };
+
+  auto streams = std::array<detail::BatchStream<T>, STREAM_COUNT>{};
+  auto isActive = std::array<bool, STREAM_COUNT>{};
+  for (;;) {
+    // finished streams are replaced, so that the loop below doesn't need to check them
+    for (std::size_t i = 0; i < STREAM_COUNT; ++i) {
+      if (!isActive[i]) { isActive[i] = open(streams[i]); }
+      while (isActive[i] && (!streams[i].isValid || streams[i].remaining() == 0)) {
+        close(streams[i]);
+        isActive[i] = open(streams[i]);
+      }
+    }
+    if (std::ranges::none_of(isActive, std::identity{})) { break; }
+
+    if (std::ranges::all_of(isActive, std::identity{})) {
+      auto rounds = std::ranges::min(streams | std::views::transform(&detail::BatchStream<T>::remaining));
+      for (std::size_t round = 0; round < rounds; ++round) {
+        for (auto &stream : streams) {
+          // an invalid stream is closed after this round
+          if (!stream.decodeSymbol()) { rounds = round + 1; }
+        }
+      }
+    } else {
+      // not enough streams left to fill the loop
+      for (std::size_t i = 0; i < STREAM_COUNT; ++i) {
+        while (isActive[i] && streams[i].isValid && streams[i].remaining() > 0) { streams[i].decodeSymbol(); }
+      }
+    }
+  }
+
+  if (const auto error = std::ranges::find_if(errors, [](const auto &e) { return e.has_value(); });
+      error != errors.end()) {
+    return tl::make_unexpected(fmt::format("Stream {}: {}", error - errors.begin(), **error));
+  }
+  return {};
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__STATIC_BATCH_DECODING_H
@@ -0,0 +1,79 @@
+/**
+ * @name static_chunks_decoding.h
+ * @brief functions for static huffman decoding of independent chunks
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__STATIC_CHUNKS_DECODING_H
+#define HUFF_CODEC__STATIC_CHUNKS_DECODING_H
+
+#include "BitReader.h"
+#include "models.h"
+#include "parallel.h"
+#include "static_decoding.h"
+#include <algorithm>
+#include <concepts>
+#include <fmt/core.h>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <string>
+#include <tl/expected.hpp>
+#include <vector>
+
+namespace pf::kko {
+
+/**
+ * Decode data encoded via @see encodeStaticChunks<T> function. Chunks are decoded in parallel.
+ * @param data input data
+ * @param model model used during data encoding
+ * @param threadCount amount of threads, 0 for all available threads
+ * @return unexpected when error occurs, otherwise decoded data
+ */
+template<std::integral T>
+tl::expected<std::vector<T>, std::string> decodeStaticChunks(std::ranges::contiguous_range auto &&data,
+                                                             Model<T> auto &&model, std::size_t threadCount = 0) {
+  const auto bytes = std::span<const uint8_t>{std::ranges::data(data), std::ranges::size(data)};
+  auto reader = BitReader{bytes};
+  const auto dataSize = detail::readLittleEndian<uint64_t>(reader);
+  const auto chunkSize = detail::readLittleEndian<uint32_t>(reader);
+  if (reader.isOverrun() || chunkSize == 0) { return tl::make_unexpected("Invalid chunk header"); }
+  // each symbol takes at least one bit
+  if (dataSize > bytes.size() * 8) { return tl::make_unexpected("File size doesn't match data"); }
+  const auto chunkCount = static_cast<std::size_t>((dataSize + chunkSize - 1) / chunkSize);
+  if (chunkCount > bytes.size() / sizeof(uint64_t)) { return tl::make_unexpected("File size doesn't match data"); }
+
+  auto chunkEnds = std::vector<std::size_t>(chunkCount + 1);
+  for (std::size_t index = 1; index <= chunkCount; ++index) {
+    chunkEnds[index] = detail::readLittleEndian<uint64_t>(reader);
+  }
+  const auto chunksOffset = reader.position() / 8;
+  if (reader.isOverrun() || !std::ranges::is_sorted(chunkEnds) || chunkEnds.back() > bytes.size() - chunksOffset) {
+    return tl::make_unexpected("Invalid chunk index");
+  }
+
+  auto result = std::vector<T>(dataSize);
+  auto errors = std::vector<std::optional<std::string>>(chunkCount);
+  threadCount = std::clamp<std::size_t>(threadCount == 0 ? defaultThreadCount() : threadCount, 1,
+                                        std::max<std::size_t>(chunkCount, 1));
+  parallelFor(threadCount, [&](std::size_t threadIndex) {
+    for (auto index = threadIndex; index < chunkCount; index += threadCount) {
+      const auto chunk = bytes.subspan(chunksOffset + chunkEnds[index], chunkEnds[index + 1] - chunkEnds[index]);
+      auto chunkModel = std::remove_cvref_t<decltype(model)>{model};
+      const auto chunkBegin = index * chunkSize;
+      const auto chunkOutput =
+          std::span{result}.subspan(chunkBegin, std::min<std::size_t>(chunkSize, dataSize - chunkBegin));
+      // chunks are already decoded in parallel, each of them directly to its place in result
+      const auto decoded = decodeStaticInto<T>(chunk, chunkOutput, chunkModel);
+      if (!decoded.has_value()) { errors[index] = decoded.error(); }
+    }
+  });
+  if (const auto error = std::ranges::find_if(errors, [](const auto &e) { return e.has_value(); });
+      error != errors.end()) {
+    return tl::make_unexpected(fmt::format("Chunk {}: {}", error - errors.begin(), **error));
+  }
+  return result;
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__STATIC_CHUNKS_DECODING_H
@@ -0,0 +1,86 @@
+/**
+ * @name static_chunks_encoding.h
+ * @brief functions for static huffman encoding of independent chunks
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__STATIC_CHUNKS_ENCODING_H
+#define HUFF_CODEC__STATIC_CHUNKS_ENCODING_H
+
+#include "BitWriter.h"
+#include "ByteSink.h"
+#include "parallel.h"
+#include "static_encoding.h"
+#include <algorithm>
+#include <concepts>
+#include <ranges>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+namespace pf::kko {
+
+/**
+ * Encode data as independent chunks, each of them with its own canonical table.
+ * @details Stream consists of amount of symbols (uint64_t), chunk size (uint32_t), index of chunk end offsets in bytes
+ * relative to the start of the first chunk (uint64_t per chunk) and the chunks. Each chunk is a stream of encodeStatic
+ * with its own model state, so chunks can be encoded and decoded in any order. Chunks are encoded in parallel by
+ * options.threadCount threads, 0 for all available threads.
+ * @param data data to be encoded, it isn't modified
+ * @param model
+ * @param chunkSize amount of symbols in a chunk, the last one may be shorter
+ * @param sink destination of encoded data
+ * @param options encoding options
+ */
+template<std::integral T, typename Model>
+void encodeStaticChunks(const std::ranges::random_access_range auto &data, Model &&model, std::size_t chunkSize,
+                        ByteSink auto &sink, const StaticEncodingOptions &options = {}) {
+  spdlog::info("Starting static chunk encoding");
+  const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+  chunkSize = std::clamp<std::size_t>(chunkSize, 1, UINT32_MAX);
+  const auto chunkCount = (dataSize + chunkSize - 1) / chunkSize;
+  const auto threadCount = std::clamp<std::size_t>(
+      options.threadCount == 0 ? defaultThreadCount() : options.threadCount, 1, std::max<std::size_t>(chunkCount, 1));
+  auto chunkOptions = options;
+  chunkOptions.threadCount = 1;
+
+  auto chunks = std::vector<std::vector<uint8_t>>(chunkCount);
+  parallelFor(threadCount, [&](std::size_t threadIndex) {
+    for (auto index = threadIndex; index < chunkCount; index += threadCount) {
+      const auto begin = std::ranges::begin(data) + static_cast<std::ptrdiff_t>(index * chunkSize);
+      const auto end = begin + static_cast<std::ptrdiff_t>(std::min(chunkSize, dataSize - index * chunkSize));
+      auto chunkModel = std::remove_cvref_t<Model>{model};
+      auto chunkSink = VectorSink{};
+      encodeStatic<T>(std::ranges::subrange(begin, end), chunkModel, chunkSink, chunkOptions);
+      chunks[index] = chunkSink.releaseData();
+    }
+  });
+  spdlog::info("Encoded {} chunks", chunkCount);
+
+  auto binEncoderData = BitWriter{sink};
+  binEncoderData.pushBytes(static_cast<uint64_t>(dataSize));
+  binEncoderData.pushBytes(static_cast<uint32_t>(chunkSize));
+  auto chunkEnd = uint64_t{};
+  std::ranges::for_each(chunks, [&](const auto &chunk) {
+    chunkEnd += chunk.size();
+    binEncoderData.pushBytes(chunkEnd);
+  });
+  spdlog::info("Data encoded, total length: {}[b]", binEncoderData.size() + chunkEnd * 8);
+  // the index consists of whole bytes, so chunks are copied as they are
+  binEncoderData.flush();
+  writeToSink(sink, chunks);
+}
+
+/**
+ * Encoding to memory, @see encodeStaticChunks above.
+ * @return encoded data
+ */
+template<std::integral T, typename Model = IdentityModel<T>>
+std::vector<uint8_t> encodeStaticChunks(const std::ranges::random_access_range auto &data, Model &&model,
+                                        std::size_t chunkSize, const StaticEncodingOptions &options = {}) {
+  auto sink = VectorSink{};
+  encodeStaticChunks<T>(data, std::forward<Model>(model), chunkSize, sink, options);
+  return sink.releaseData();
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__STATIC_CHUNKS_ENCODING_H
@@ -0,0 +1,198 @@
+/**
+ * @name static_common.h
+ * @brief code construction shared by static huffman encoders
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__STATIC_COMMON_H
+#define HUFF_CODEC__STATIC_COMMON_H
+
+#include "histogram.h"
+#include "utils.h"
+#include <algorithm>
+#include <cassert>
+#include <concepts>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace pf::kko {
+namespace detail {
+/**
+ * In-place computation of huffman code lengths by Moffat and Katajainen.
+ * @param weights weights sorted in ascending order, they are replaced by code lengths of respective symbols
+ */
+inline void computeCodeLengthsInPlace(std::span<std::size_t> weights) {
+  const auto n = weights.size();
+  if (n == 0) { return; }
+  if (n == 1) {
+    weights[0] = 0;
+    return;
+  }
+  auto &a = weights;
+  // first pass, left to right, merging the two lightest items into internal nodes and setting parent pointers
+  a[0] += a[1];
+  auto root = std::size_t{0};
+  auto leaf = std::size_t{2};
+  for (std::size_t next = 1; next < n - 1; ++next) {
+    if (leaf >= n || a[root] < a[leaf]) {
+      a[next] = a[root];
+      a[root++] = next;
+    } else {
+      a[next] = a[leaf++];
+    }
+    if (leaf >= n || (root < next && a[root] < a[leaf])) {
+      a[next] += a[root];
+      a[root++] = next;
+    } else {
+      a[next] += a[leaf++];
+    }
+  }
+  // second pass, right to left, converting parent pointers to depths of internal nodes
+  a[n - 2] = 0;
+  for (auto next = n - 2; next-- > 0;) { a[next] = a[a[next]] + 1; }
+  // third pass, right to left, converting depths of internal nodes to depths of leaves
+  auto available = std::size_t{1};
+  auto used = std::size_t{0};
+  auto depth = std::size_t{0};
+  auto internal = static_cast<std::ptrdiff_t>(n) - 2;
+  auto next = static_cast<std::ptrdiff_t>(n) - 1;
+  while (available > 0) {
+    while (internal >= 0 && a[internal] == depth) {
+      ++used;
+      --internal;
+    }
+    while (available > used) {
+      a[next--] = depth;
+      --available;
+    }
+    available = 2 * used;
+    ++depth;
+    used = 0;
+  }
+}
+
+/**
+ * Computation of huffman code lengths limited to maxLength bits by package-merge algorithm.
+ * @details A list of items is built for each bit of code length, starting with the deepest one. Each list consists of
+ * leaves and packages - pairs of consecutive items from the deeper list - merged by weight. The first 2n - 2 items of
+ * the top list are selected, a selected package selects its both items in the deeper list and each selection of a leaf
+ * adds a bit to its code length.
+ * @param weights weights sorted in ascending order, there can't be more than 2^maxLength of them
+ * @param maxLength maximum code length
+ * @return code length for each weight
+ */
+inline std::vector<std::size_t> computeLimitedCodeLengths(std::span<const std::size_t> weights, std::size_t maxLength) {
+  const auto n = weights.size();
+  auto lengths = std::vector<std::size_t>(n);
+  if (n < 2) { return lengths; }
+  assert(maxLength < 64 && (std::size_t{1} << maxLength) >= n);
+
+  // isLeaf flags of each list, from the deepest one to the top one
+  auto lists = std::vector<std::vector<bool>>(maxLength);
+  auto previousWeights = std::vector<std::size_t>{};
+  auto currentWeights = std::vector<std::size_t>{};
+  for (std::size_t level = 0; level < maxLength; ++level) {
+    auto &isLeaf = lists[level];
+    currentWeights.clear();
+    auto leaf = std::size_t{};
+    auto package = std::size_t{};
+    const auto packageCount = previousWeights.size() / 2;
+    while (leaf < n || package < packageCount) {
+      const auto packageWeight =
+          package < packageCount ? previousWeights[2 * package] + previousWeights[2 * package + 1] : 0;
+      if (package >= packageCount || (leaf < n && weights[leaf] <= packageWeight)) {
+        currentWeights.emplace_back(weights[leaf++]);
+        isLeaf.emplace_back(true);
+      } else {
+        currentWeights.emplace_back(packageWeight);
+        isLeaf.emplace_back(false);
+        ++package;
+      }
+    }
+    std::swap(previousWeights, currentWeights);
+  }
+
+  auto selected = 2 * n - 2;
+  for (auto level = maxLength; level-- > 0 && selected > 0;) {
+    auto leaf = std::size_t{};
+    auto packages = std::size_t{};
+    for (std::size_t i = 0; i < selected; ++i) {
+      if (lists[level][i]) {
+        ++lengths[leaf++];
+      } else {
+        ++packages;
+      }
+    }
+    selected = 2 * packages;
+  }
+  return lengths;
+}
+}// namespace detail
+
+/**
+ * Assign canonical codes to symbols sorted by their code length.
+ * @param codes symbols with code lengths set, sorted by code length
+ */
+template<std::integral T>
+void assignCanonicalCodes(std::vector<std::pair<T, BitCode>> &codes) {
+  if (codes.empty()) { return; }
+  codes.front().second.bits = 0;
+  for (std::size_t cnt = 1; cnt < codes.size(); ++cnt) {
+    const auto &previousCode = codes[cnt - 1].second;
+    auto &code = codes[cnt].second;
+    code.bits = (previousCode.bits + 1) << (code.length - previousCode.length);
+  }
+}
+
+/**
+ * Create canonical huffman codes directly from histogram, without building a tree.
+ * @details If there is only one symbol in histogram a dummy symbol is added, so that each code has at least 1 bit.
+ * @param histogram histogram of occurrences in input data
+ * @param maxCodeLength maximum length of a code in bits, 0 for unlimited
+ * @throws std::invalid_argument when maxCodeLength is too small to encode all symbols present in histogram
+ * @return pairs of symbol and its code, sorted by code length and symbol
+ */
+template<std::integral T>
+std::vector<std::pair<T, BitCode>> buildCanonicalCodes(const Histogram<T> &histogram, std::size_t maxCodeLength = 0) {
+  using UnsignedT = std::make_unsigned_t<T>;
+  auto symbols = std::vector<std::pair<std::size_t, UnsignedT>>{};
+  symbols.reserve(histogram.size());
+  for (std::size_t symbol = 0; symbol < histogram.size(); ++symbol) {
+    if (histogram[symbol] > 0) { symbols.emplace_back(histogram[symbol], static_cast<UnsignedT>(symbol)); }
+  }
+  if (symbols.size() == 1) { symbols.emplace_back(0, static_cast<UnsignedT>(symbols.front().second == 0 ? 1 : 0)); }
+  std::ranges::sort(symbols);
+
+  auto lengths = std::vector<std::size_t>(symbols.size());
+  std::ranges::transform(symbols, lengths.begin(), [](const auto &symbol) { return symbol.first; });
+  detail::computeCodeLengthsInPlace(lengths);
+  if (maxCodeLength != 0 && maxCodeLength < BitCode::MAX_LENGTH && !lengths.empty()
+      && lengths.front() > maxCodeLength) {
+    if ((std::size_t{1} << maxCodeLength) < symbols.size()) {
+      throw std::invalid_argument("Maximum code length is too small for amount of symbols");
+    }
+    auto weights = std::vector<std::size_t>(symbols.size());
+    std::ranges::transform(symbols, weights.begin(), [](const auto &symbol) { return symbol.first; });
+    lengths = detail::computeLimitedCodeLengths(weights, maxCodeLength);
+  }
+  if (!lengths.empty() && lengths.front() > BitCode::MAX_LENGTH) {
+    throw std::runtime_error("Huffman code longer than 64 bits");
+  }
+
+  auto result = std::vector<std::pair<T, BitCode>>{};
+  result.reserve(symbols.size());
+  for (std::size_t i = 0; i < symbols.size(); ++i) {
+    result.emplace_back(static_cast<T>(symbols[i].second), BitCode{0, static_cast<uint8_t>(lengths[i])});
+  }
+  std::ranges::sort(result, [](const auto &lhs, const auto &rhs) {
+    return std::pair{lhs.second.length, static_cast<UnsignedT>(lhs.first)}
+        < std::pair{rhs.second.length, static_cast<UnsignedT>(rhs.first)};
+  });
+  assignCanonicalCodes(result);
+  return result;
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__STATIC_COMMON_H
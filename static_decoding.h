@@ -8,94 +8,524 @@
 #ifndef PF_HUFF_CODEC__DECOMPRESSION_H
 #define PF_HUFF_CODEC__DECOMPRESSION_H
 
+#include "BitReader.h"
+#include "DecodingTable.h"
 #include "constants.h"
 #include "models.h"
+#include "parallel.h"
 #include "utils.h"
+#include <algorithm>
+#include <array>
 #include <fmt/core.h>
+#include <limits>
 #include <numeric>
+#include <optional>
 #include <ranges>
+#include <span>
 #include <spdlog/spdlog.h>
+#include <stdexcept>
+#include <utility>
+#include <vector>
 #include <tl/expected.hpp>
 
 namespace pf::kko {
 
+namespace detail {
 /**
- * Decode data encoded via @see encodeStatic<T> function
- * @tparam Model model used during data encoding
+ * Code tables and payload location read from the header of a static stream.
+ */
+struct StaticHeader {
+  /**
+   * Amount of codes of each length, index 0 being for length 1.
+   */
+  std::vector<std::size_t> lengthCounts;
+  /**
+   * Symbols sorted in canonical order.
+   */
+  std::vector<std::size_t> symbols;
+  std::size_t payloadOffset;
+  std::size_t padding;
+  /**
+   * Payload consists of INTERLEAVED_STREAM_COUNT streams.
+   */
+  bool isInterleaved;
+};
+
+/**
+ * Read integer stored in little endian byte order.
+ */
+template<std::unsigned_integral T>
+T readLittleEndian(BitReader &reader) {
+  auto result = T{};
+  for (std::size_t i = 0; i < sizeof(T); ++i) { result |= static_cast<T>(reader.read(8) << (i * 8)); }
+  return result;
+}
+
+/**
+ * Read header of data encoded via @see encodeStatic<T> function.
  * @param data input data
- * @return unexpected when error occurs, otherwise decoded data
+ * @return unexpected when the header is malformed, otherwise parsed header
  */
-template<std::integral T>
-tl::expected<std::vector<T>, std::string> decodeStatic(std::ranges::forward_range auto &&data, Model<T> auto &&model) {
-  auto iter = std::ranges::begin(data);
-  const auto dataSize = std::ranges::size(data);
+inline tl::expected<StaticHeader, std::string> readStaticHeader(std::span<const uint8_t> data) {
+  const auto dataSize = data.size();
+  if (dataSize < 2) { return tl::make_unexpected("File size doesn't match data"); }
+  auto iter = data.begin();
+  if (*iter == DICTIONARY_STREAM_MARKER) {
+    return tl::make_unexpected("Data encoded with a static dictionary, the dictionary is required for decoding");
+  }
 
-  const auto maxCodeLengthInfo = static_cast<std::size_t>(*iter++);
+  const auto isInterleaved = (*iter & INTERLEAVED_STREAMS_FLAG) != 0;
+  const auto maxCodeLengthInfo = static_cast<std::size_t>(*iter++ & ~INTERLEAVED_STREAMS_FLAG);
 
   if (dataSize < maxCodeLengthInfo + 1) { return tl::make_unexpected("File size doesn't match data"); }
   const auto paddingInfo = *iter++;
-  const auto padding = (paddingInfo & PADDING_MASK) >> PADDING_SHIFT;
-  const auto minCodeLengthInfo = paddingInfo & (~PADDING_MASK);
+  const auto padding = static_cast<std::size_t>((paddingInfo & PADDING_MASK) >> PADDING_SHIFT);
+  const auto minCodeLengthInfo = static_cast<std::size_t>(paddingInfo & (~PADDING_MASK));
+  if (minCodeLengthInfo >= maxCodeLengthInfo) { return tl::make_unexpected("Invalid code lengths in header"); }
   const auto lenDiff = maxCodeLengthInfo - minCodeLengthInfo;
 
   auto byteLengths = std::vector<std::size_t>{};
   byteLengths.resize(minCodeLengthInfo, 0);
 
   auto symbolsLength = std::size_t{};
-  for (auto i = lenDiff + 1; iter != std::ranges::begin(data) + i;) {
+  for (auto i = lenDiff + 1; iter != data.begin() + i;) {
     auto indexLength = static_cast<std::size_t>(*iter++);
     if (indexLength == 0 && minCodeLengthInfo == 7) { indexLength = 256; }
-    byteLengths.template emplace_back(indexLength);
+    byteLengths.emplace_back(indexLength);
     symbolsLength += indexLength;
   }
 
   if (dataSize < lenDiff + symbolsLength + 1) { return tl::make_unexpected("Not enough data"); }
 
   const auto byteCount = (lenDiff + 1 + symbolsLength);
-  const auto currentIterPos = std::ranges::distance(std::ranges::begin(data), iter);
-  auto symbols = std::vector<std::size_t>(iter, iter + (byteCount - currentIterPos));
-  iter += byteCount - currentIterPos;
-
-  auto counterOnes = std::size_t{1};
-  auto counterZeros = std::size_t{};
-
-  auto zeros = std::vector<std::size_t>{counterZeros};
-  auto ones = std::vector<std::size_t>{counterOnes};
-  std::ranges::for_each(byteLengths, [&](const auto byteLength) {
-    counterOnes += byteLength;
-    counterZeros += byteLength;
-    counterZeros *= 2;
-    zeros.template emplace_back(counterZeros);
-    ones.template emplace_back(counterOnes);
+  const auto currentIterPos = static_cast<std::size_t>(std::ranges::distance(data.begin(), iter));
+  auto symbols = std::vector<std::size_t>(iter, iter + static_cast<std::ptrdiff_t>(byteCount - currentIterPos));
+  return StaticHeader{std::move(byteLengths), std::move(symbols), byteCount, padding, isInterleaved};
+}
+
+/**
+ * Decode codes starting before end, all codes of a lookup are decoded, so the last one may end past end.
+ * @details Close to the end of valid data codes are decoded one at a time, an incomplete code at the end is dropped.
+ * @param reader source of codes
+ * @param end position of reader, at which decoding stops
+ * @param table table of codes
+ * @param output destination of decoded symbols, there has to be space for MultiSymbolEntry::MAX_SYMBOLS symbols past
+ * the last one
+ * @return pointer past the last decoded symbol, nullptr when input contains an invalid code
+ */
+template<std::integral T>
+T *decodeStreamUntil(BitReader &reader, std::size_t end, const DecodingTable &table, T *output) {
+  while (reader.position() < end && reader.position() + DecodingTable::MULTI_SYMBOL_BITS <= reader.size()) {
+    const auto count = table.decodeMultiple(reader, output);
+    if (count == 0) { return nullptr; }
+    output += count;
+  }
+  // incomplete code at the end of data
+  if (reader.isOverrun()) { --output; }
+  while (reader.position() < end) {
+    if (!table.decode(reader, *output)) { return nullptr; }
+    if (reader.isOverrun()) { break; }
+    ++output;
+  }
+  return output;
+}
+
+/**
+ * Decode a single stream of codes.
+ * @param payload encoded data
+ * @param padding amount of padding bits at the end of payload
+ * @param minCodeLength length of the shortest code
+ * @param table table of codes
+ * @return unexpected when error occurs, otherwise decoded data
+ */
+template<std::integral T>
+tl::expected<std::vector<T>, std::string> decodeStaticStream(std::span<const uint8_t> payload, std::size_t padding,
+                                                             std::size_t minCodeLength, const DecodingTable &table) {
+  auto reader = BitReader{payload, payload.size() * 8 - padding};
+  // each code has at least minCodeLength bits, extra space is for symbols written past the last one
+  auto result = std::vector<T>(reader.size() / minCodeLength + DecodingTable::MultiSymbolEntry::MAX_SYMBOLS);
+  const auto output = decodeStreamUntil(reader, reader.size(), table, result.data());
+  if (output == nullptr) { return tl::make_unexpected("Invalid code in input data"); }
+  result.resize(static_cast<std::size_t>(output - result.data()));
+  // the bound counts bits, for 1 bit codes it's several times larger than the result
+  result.shrink_to_fit();
+  return result;
+}
+
+/**
+ * Parts of a single stream decoded speculatively are at least this large in bytes, so that decoding from a wrong
+ * position synchronizes with the correct one long before the part ends.
+ */
+constexpr std::size_t MIN_SPECULATIVE_PART_SIZE = 64 * 1024;
+/**
+ * Amount of lookups at the start of a speculatively decoded part, at which the decoder from the correct position may
+ * synchronize with it.
+ */
+constexpr std::size_t SPECULATIVE_CHECKPOINT_COUNT = 1024;
+
+/**
+ * Create reader of stream positioned at bitPosition.
+ * @details Reader starts at the byte containing bitPosition, so its positions are offset by bitPosition / 8 * 8.
+ */
+inline BitReader makeReaderAt(std::span<const uint8_t> payload, std::size_t bitSize, std::size_t bitPosition) {
+  const auto byteOffset = bitPosition / 8;
+  auto reader = BitReader{payload.subspan(byteOffset), bitSize - byteOffset * 8};
+  if (const auto skippedBits = bitPosition % 8; skippedBits != 0) {
+    [[maybe_unused]] const auto skipped = reader.read(skippedBits);
+  }
+  return reader;
+}
+
+/**
+ * Part of a single stream decoded from a position, which may not be a code boundary.
+ */
+template<std::integral T>
+struct SpeculativePart {
+  std::vector<T> symbols;
+  /**
+   * Stream positions after the first lookups of the part and amount of symbols decoded before each of them. Once a
+   * decoder starting at the correct position reaches one of them, the rest of the part has been decoded correctly.
+   */
+  std::vector<std::pair<std::size_t, std::size_t>> checkpoints;
+  /**
+   * Stream position past the last code of the part, the code starts before the end of the part.
+   */
+  std::size_t end{};
+  /**
+   * False when an invalid code was met, which may be caused by a wrong starting position.
+   */
+  bool isValid{};
+};
+
+/**
+ * Decode codes of stream starting in [begin, end), as if begin was a code boundary.
+ * @param payload encoded data
+ * @param bitSize amount of valid bits in payload
+ * @param begin start of the part in bits
+ * @param end end of the part in bits
+ * @param minCodeLength length of the shortest code
+ * @param table table of codes
+ */
+template<std::integral T>
+SpeculativePart<T> decodeSpeculatively(std::span<const uint8_t> payload, std::size_t bitSize, std::size_t begin,
+                                       std::size_t end, std::size_t minCodeLength, const DecodingTable &table) {
+  constexpr auto MAX_SYMBOLS = DecodingTable::MultiSymbolEntry::MAX_SYMBOLS;
+  auto reader = makeReaderAt(payload, bitSize, begin);
+  const auto offset = begin / 8 * 8;
+  auto part = SpeculativePart<T>{};
+  // codes starting in the part and symbols of the last lookup, which may continue past the part
+  part.symbols.resize((end - begin) / minCodeLength + 2 * MAX_SYMBOLS);
+  part.checkpoints.reserve(SPECULATIVE_CHECKPOINT_COUNT);
+  auto output = part.symbols.data();
+  while (part.checkpoints.size() < SPECULATIVE_CHECKPOINT_COUNT && offset + reader.position() < end
+         && reader.position() + DecodingTable::MULTI_SYMBOL_BITS <= reader.size()) {
+    const auto count = table.decodeMultiple(reader, output);
+    if (count == 0) { return part; }
+    output += count;
+    part.checkpoints.emplace_back(offset + reader.position(), static_cast<std::size_t>(output - part.symbols.data()));
+  }
+  output = decodeStreamUntil(reader, end - offset, table, output);
+  if (output == nullptr) { return part; }
+  part.symbols.resize(static_cast<std::size_t>(output - part.symbols.data()));
+  part.symbols.shrink_to_fit();
+  part.end = offset + reader.position();
+  part.isValid = true;
+  return part;
+}
+
+/**
+ * Decode part of stream from the correct code boundary until it reaches a checkpoint of the speculatively decoded
+ * part, symbols decoded up to the checkpoint replace those of the part. If it doesn't, the whole part is decoded again.
+ * @param payload encoded data
+ * @param bitSize amount of valid bits in payload
+ * @param begin correct start of the part in bits, at or after the speculative start
+ * @param end end of the part in bits
+ * @param minCodeLength length of the shortest code
+ * @param table table of codes
+ * @param part speculatively decoded part, it's replaced by the correct result
+ * @return unexpected when input contains an invalid code
+ */
+template<std::integral T>
+tl::expected<void, std::string> synchronizePart(std::span<const uint8_t> payload, std::size_t bitSize,
+                                                std::size_t begin, std::size_t end, std::size_t minCodeLength,
+                                                const DecodingTable &table, SpeculativePart<T> &part) {
+  // the previous part ended with a code, which covers the whole part
+  if (begin >= end) {
+    part.symbols.clear();
+    part.end = begin;
+    part.isValid = true;
+    return {};
+  }
+  auto reader = makeReaderAt(payload, bitSize, begin);
+  const auto offset = begin / 8 * 8;
+  auto symbols = std::vector<T>{};
+  if (part.isValid) {
+    auto checkpoint = part.checkpoints.begin();
+    auto symbol = T{};
+    while (checkpoint != part.checkpoints.end() && offset + reader.position() < end) {
+      if (!table.decode(reader, symbol)) { return tl::make_unexpected("Invalid code in input data"); }
+      if (reader.isOverrun()) { break; }
+      symbols.emplace_back(symbol);
+      const auto position = offset + reader.position();
+      checkpoint = std::ranges::find_if(checkpoint, part.checkpoints.end(),
+                                        [position](const auto &c) { return c.first >= position; });
+      if (checkpoint != part.checkpoints.end() && checkpoint->first == position) {
+        symbols.insert(symbols.end(), part.symbols.begin() + static_cast<std::ptrdiff_t>(checkpoint->second),
+                       part.symbols.end());
+        part.symbols = std::move(symbols);
+        return {};
+      }
+    }
+  }
+  // no synchronization, decode the rest of the part again
+  const auto decodedCount = symbols.size();
+  if (!reader.isOverrun()) {
+    const auto position = offset + reader.position();
+    symbols.resize(decodedCount + (end - std::min(end, position)) / minCodeLength
+                   + 2 * DecodingTable::MultiSymbolEntry::MAX_SYMBOLS);
+    const auto output = decodeStreamUntil(reader, end - offset, table, symbols.data() + decodedCount);
+    if (output == nullptr) { return tl::make_unexpected("Invalid code in input data"); }
+    symbols.resize(static_cast<std::size_t>(output - symbols.data()));
+    symbols.shrink_to_fit();
+  }
+  part.symbols = std::move(symbols);
+  part.end = offset + reader.position();
+  part.isValid = true;
+  return {};
+}
+
+/**
+ * Decode a single stream of codes on multiple threads, @see decodeStaticStream.
+ * @details Stream has no index of code boundaries, so each thread starts decoding its part at an arbitrary bit and
+ * records positions it reaches. Canonical huffman codes synchronize quickly - a decoder starting in the middle of a
+ * code soon ends a code at the same position as a decoder starting at a code boundary. So once the previous part is
+ * known to end at a boundary, its part is fixed by decoding from there until reaching one of the recorded positions.
+ * @param payload encoded data
+ * @param padding amount of padding bits at the end of payload
+ * @param minCodeLength length of the shortest code
+ * @param table table of codes
+ * @param partCount amount of parts decoded at the same time
+ * @return unexpected when error occurs, otherwise decoded data
+ */
+template<std::integral T>
+tl::expected<std::vector<T>, std::string> decodeStaticStreamParallel(std::span<const uint8_t> payload,
+                                                                     std::size_t padding, std::size_t minCodeLength,
+                                                                     const DecodingTable &table,
+                                                                     std::size_t partCount) {
+  const auto bitSize = payload.size() * 8 - padding;
+  auto parts = std::vector<SpeculativePart<T>>(partCount);
+  parallelFor(partCount, [&](std::size_t index) {
+    const auto [begin, end] = splitRange(bitSize, partCount, index);
+    parts[index] = decodeSpeculatively<T>(payload, bitSize, begin, end, minCodeLength, table);
   });
+  if (!parts.front().isValid) { return tl::make_unexpected("Invalid code in input data"); }
+  for (std::size_t index = 1; index < partCount; ++index) {
+    const auto [begin, end] = splitRange(bitSize, partCount, index);
+    const auto correctBegin = parts[index - 1].end;
+    if (correctBegin == begin && parts[index].isValid) { continue; }
+    const auto synchronized =
+        synchronizePart<T>(payload, bitSize, correctBegin, end, minCodeLength, table, parts[index]);
+    if (!synchronized.has_value()) { return tl::make_unexpected(synchronized.error()); }
+  }
 
   auto result = std::vector<T>{};
-  auto readBytesCounter = static_cast<std::size_t>(std::ranges::distance(data.begin(), iter));
-  counterOnes = 0;
-  counterZeros = 0;
+  result.reserve(std::accumulate(parts.begin(), parts.end(), std::size_t{},
+                                 [](auto sum, const auto &part) { return sum + part.symbols.size(); }));
+  std::ranges::for_each(parts, [&result](const auto &part) {
+    result.insert(result.end(), part.symbols.begin(), part.symbols.end());
+  });
+  return result;
+}
+
+/**
+ * Decode a known amount of symbols.
+ * @details As the amount is known, multiple symbols are decoded at a time while there is space for the most a lookup
+ * can decode, padding can't be decoded this way. Invalid input is detected by overrun at the end.
+ * @param reader source of codes
+ * @param table table of codes
+ * @param output destination of decoded symbols
+ * @return unexpected when input is invalid or there is not enough of it
+ */
+template<std::integral T>
+tl::expected<void, std::string> decodeStaticSymbols(BitReader &reader, const DecodingTable &table,
+                                                    std::span<T> output) {
+  auto iter = output.data();
+  const auto end = iter + output.size();
+  while (static_cast<std::size_t>(end - iter) >= DecodingTable::MultiSymbolEntry::MAX_SYMBOLS) {
+    const auto count = table.decodeMultiple(reader, iter);
+    if (count == 0) { return tl::make_unexpected("Invalid code in input data"); }
+    iter += count;
+  }
+  for (; iter != end; ++iter) {
+    if (!table.decode(reader, *iter)) { return tl::make_unexpected("Invalid code in input data"); }
+  }
+  if (reader.isOverrun()) { return tl::make_unexpected("Not enough data"); }
+  return {};
+}
+
+/**
+ * Decode INTERLEAVED_STREAM_COUNT streams, each of them containing a consecutive part of the data.
+ * @details Payload starts with amount of symbols and byte sizes of all streams but the last one, all of them uint64_t.
+ * Decoding of all streams is interleaved in a single loop, so that the processor can work on their independent
+ * lookups at the same time.
+ * @param payload encoded data
+ * @param table table of codes
+ * @param output destination of decoded symbols, its size has to match amount of symbols in payload
+ * @return unexpected when error occurs
+ */
+template<std::integral T>
+tl::expected<void, std::string> decodeStaticInterleaved(std::span<const uint8_t> payload, const DecodingTable &table,
+                                                        std::span<T> output) {
+  constexpr auto STREAM_COUNT = INTERLEAVED_STREAM_COUNT;
+  auto indexReader = BitReader{payload};
+  const auto symbolCount = readLittleEndian<uint64_t>(indexReader);
+  auto streamEnds = std::array<std::size_t, STREAM_COUNT + 1>{};
+  for (std::size_t i = 1; i < STREAM_COUNT; ++i) {
+    streamEnds[i] = streamEnds[i - 1] + readLittleEndian<uint64_t>(indexReader);
+  }
+  const auto streamsOffset = indexReader.position() / 8;
+  if (indexReader.isOverrun()) { return tl::make_unexpected("Not enough data"); }
+  streamEnds[STREAM_COUNT] = payload.size() - streamsOffset;
+  if (!std::ranges::is_sorted(streamEnds)) { return tl::make_unexpected("Invalid stream sizes"); }
+  // each symbol takes at least one bit
+  if (symbolCount > payload.size() * 8) { return tl::make_unexpected("File size doesn't match data"); }
+  if (symbolCount != output.size()) { return tl::make_unexpected("Output size doesn't match data"); }
+
+  auto readers = [&]<std::size_t... I>(std::index_sequence<I...>) {
+    return std::array{BitReader{payload.subspan(streamsOffset + streamEnds[I], streamEnds[I + 1] - streamEnds[I])}...};
+  }(std::make_index_sequence<STREAM_COUNT>{});
+  auto outputs = std::array<T *, STREAM_COUNT>{};
+  auto outputEnds = std::array<T *, STREAM_COUNT>{};
+  for (std::size_t i = 0; i < STREAM_COUNT; ++i) {
+    const auto [begin, end] = splitRange(symbolCount, STREAM_COUNT, i);
+    outputs[i] = output.data() + begin;
+    outputEnds[i] = output.data() + end;
+  }
+
+  // amount of symbols of each stream is known, so a lookup can't decode padding as long as there is space for the most
+  // symbols it can decode, invalid input is detected by overrun at the end
+  constexpr auto MAX_SYMBOLS = DecodingTable::MultiSymbolEntry::MAX_SYMBOLS;
+  for (;;) {
+    auto rounds = std::numeric_limits<std::size_t>::max();
+    for (std::size_t i = 0; i < STREAM_COUNT; ++i) {
+      rounds = std::min(rounds, static_cast<std::size_t>(outputEnds[i] - outputs[i]) / MAX_SYMBOLS);
+    }
+    if (rounds == 0) { break; }
+    for (std::size_t round = 0; round < rounds; ++round) {
+      for (std::size_t i = 0; i < STREAM_COUNT; ++i) {
+        const auto count = table.decodeMultiple(readers[i], outputs[i]);
+        if (count == 0) { return tl::make_unexpected("Invalid code in input data"); }
+        outputs[i] += count;
+      }
+    }
+  }
+  for (std::size_t i = 0; i < STREAM_COUNT; ++i) {
+    const auto decoded = decodeStaticSymbols(readers[i], table, std::span<T>{outputs[i], outputEnds[i]});
+    if (!decoded.has_value()) { return tl::make_unexpected(decoded.error()); }
+  }
+  return {};
+}
+
+/**
+ * Decoding of interleaved streams to memory, @see decodeStaticInterleaved above.
+ * @return unexpected when error occurs, otherwise decoded data
+ */
+template<std::integral T>
+tl::expected<std::vector<T>, std::string> decodeStaticInterleaved(std::span<const uint8_t> payload,
+                                                                  const DecodingTable &table) {
+  auto reader = BitReader{payload};
+  const auto symbolCount = readLittleEndian<uint64_t>(reader);
+  // each symbol takes at least one bit
+  if (reader.isOverrun() || symbolCount > payload.size() * 8) {
+    return tl::make_unexpected("File size doesn't match data");
+  }
+  auto result = std::vector<T>(symbolCount);
+  return decodeStaticInterleaved(payload, table, std::span<T>{result}).map([&result] { return std::move(result); });
+}
+}// namespace detail
+
+/**
+ * Payloads of a single stream larger than this are decoded on multiple threads by decodeStatic, unless the amount of
+ * threads is set.
+ */
+constexpr std::size_t PARALLEL_DECODE_THRESHOLD = 4 * 1024 * 1024;
+
+/**
+ * Decode data encoded via @see encodeStatic<T> function
+ * @details Codes are resolved by DecodingTable, short codes several at a time, a longer code by a single lookup unless
+ * it's longer than DecodingTable::PRIMARY_BITS. A single stream is decoded on multiple threads by speculative decoding
+ * of its parts, @see detail::decodeStaticStreamParallel, so that streams of any version of the format can be decoded
+ * in parallel. Interleaved streams are decoded on a single thread.
+ * @tparam Model model used during data encoding
+ * @param data input data
+ * @param threadCount amount of threads decoding a single stream, 0 for all available threads if the payload is larger
+ * than PARALLEL_DECODE_THRESHOLD
+ * @return unexpected when error occurs, otherwise decoded data
+ */
+template<std::integral T>
+tl::expected<std::vector<T>, std::string> decodeStatic(std::ranges::contiguous_range auto &&data,
+                                                       Model<T> auto &&model, std::size_t threadCount = 0) {
+  const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+  const auto header = detail::readStaticHeader(std::span<const uint8_t>{std::ranges::data(data), dataSize});
+  if (!header.has_value()) { return tl::make_unexpected(header.error()); }
+  const auto &[lengthCounts, symbols, payloadOffset, padding, isInterleaved] = *header;
+
+  auto table = std::optional<DecodingTable>{};
   try {
-    std::for_each(iter, std::ranges::end(data), [&](const auto byte) {
-      const auto usedBitsInByte = readBytesCounter == dataSize - 1 ? 8 - padding : 8;
-      auto bitCnt = 0;
-      forEachBit_n(byte, usedBitsInByte, [&](bool bit) {
-        counterOnes += 1;
-        counterZeros *= 2;
-        counterZeros += (bit ? 1 : 0);
-        if (counterZeros * 2 < zeros[counterOnes]) {
-          const auto index = ones[counterOnes - 1] + counterZeros - zeros[counterOnes - 1] - 1;
-          if (index >= symbolsLength) { throw std::runtime_error("Invalid code in input data"); }
-          result.emplace_back(symbols[index]);
-          counterOnes = 0;
-          counterZeros = 0;
-        }
-        ++bitCnt;
-      });
-      ++readBytesCounter;
-    });
-  } catch (const std::runtime_error &e) { return tl::make_unexpected(e.what()); }
-  std::ranges::transform(result, std::ranges::begin(result), makeRevertLambda<T>(model));
+    table.emplace(lengthCounts, symbols);
+  } catch (const std::invalid_argument &e) { return tl::make_unexpected(e.what()); }
+
+  const auto payload = std::span<const uint8_t>{std::ranges::data(data) + payloadOffset, dataSize - payloadOffset};
+  const auto minCodeLength = static_cast<std::size_t>(std::ranges::find_if(lengthCounts, [](auto count) {
+                               return count != 0;
+                             }) - lengthCounts.begin()) + 1;
+  if (threadCount == 0) { threadCount = payload.size() >= PARALLEL_DECODE_THRESHOLD ? defaultThreadCount() : 1; }
+  const auto partCount = std::clamp<std::size_t>(
+      threadCount, 1, std::max<std::size_t>(1, payload.size() / detail::MIN_SPECULATIVE_PART_SIZE));
+  auto result = [&] {
+    if (isInterleaved) { return detail::decodeStaticInterleaved<T>(payload, *table); }
+    if (partCount > 1) {
+      return detail::decodeStaticStreamParallel<T>(payload, padding, minCodeLength, *table, partCount);
+    }
+    return detail::decodeStaticStream<T>(payload, padding, minCodeLength, *table);
+  }();
+  if (!result.has_value()) { return result; }
+  std::ranges::transform(*result, std::ranges::begin(*result), makeRevertLambda<T>(model));
   return result;
 }
+
+/**
+ * Decode data encoded via @see encodeStatic<T> function into caller owned memory on a single thread.
+ * @details Amount of symbols is known, so no memory is allocated for them.
+ * @param data input data
+ * @param output destination of decoded data, its size has to match amount of encoded symbols
+ * @param model model used during encoding
+ * @return unexpected when error occurs or data contain a different amount of symbols
+ */
+template<std::integral T>
+tl::expected<void, std::string> decodeStaticInto(std::span<const uint8_t> data, std::span<T> output,
+                                                 Model<T> auto &&model) {
+  const auto header = detail::readStaticHeader(data);
+  if (!header.has_value()) { return tl::make_unexpected(header.error()); }
+  auto table = std::optional<DecodingTable>{};
+  try {
+    table.emplace(header->lengthCounts, header->symbols);
+  } catch (const std::invalid_argument &e) { return tl::make_unexpected(e.what()); }
+
+  const auto payload = data.subspan(header->payloadOffset);
+  if (header->isInterleaved) {
+    const auto decoded = detail::decodeStaticInterleaved(payload, *table, output);
+    if (!decoded.has_value()) { return decoded; }
+  } else {
+    if (header->padding > payload.size() * 8) { return tl::make_unexpected("File size doesn't match data"); }
+    auto reader = BitReader{payload, payload.size() * 8 - header->padding};
+    const auto decoded = detail::decodeStaticSymbols(reader, *table, output);
+    if (!decoded.has_value()) { return decoded; }
+    if (reader.position() != reader.size()) { return tl::make_unexpected("Output size doesn't match data"); }
+  }
+  std::ranges::transform(output, output.begin(), makeRevertLambda<T>(model));
+  return {};
+}
 }// namespace pf::kko
 
 #endif//PF_HUFF_CODEC__DECOMPRESSION_H
@@ -0,0 +1,216 @@
+/**
+ * @name static_dictionary.h
+ * @brief static huffman encoding with codes trained on a sample corpus and shared by many streams
+ * @author Petr Flajšingr, xflajs00
+ * @date 16.10.2026
+ */
+#ifndef HUFF_CODEC__STATIC_DICTIONARY_H
+#define HUFF_CODEC__STATIC_DICTIONARY_H
+
+#include "BitReader.h"
+#include "BitWriter.h"
+#include "ByteSink.h"
+#include "DecodingTable.h"
+#include "histogram.h"
+#include "models.h"
+#include "static_common.h"
+#include "static_decoding.h"
+#include "static_encoding.h"
+#include <algorithm>
+#include <array>
+#include <concepts>
+#include <fmt/core.h>
+#include <ranges>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <tl/expected.hpp>
+#include <vector>
+
+namespace pf::kko {
+
+/**
+ * Canonical codes shared by many static streams, prepared for both encoding and decoding.
+ * @details Serialized dictionary consists of its id (uint32_t) and a header of static stream. Id is FNV-1a hash of the
+ * header, so a stream can't be decoded with a different dictionary than the one it was encoded with.
+ */
+template<std::integral T>
+class StaticDictionary {
+ public:
+  /**
+   * @param symbolCodes canonical codes sorted by code length and symbol
+   * @throws std::invalid_argument when codes can't be decoded by DecodingTable
+   */
+  explicit StaticDictionary(std::vector<std::pair<T, BitCode>> symbolCodes)
+      : codes(std::move(symbolCodes)), codeTable(detail::createCodeTable(codes)), header(createHeader(codes)),
+        decodingTable(createDecodingTable(codes)), id(hash(header)) {}
+
+  [[nodiscard]] uint32_t getId() const { return id; }
+  [[nodiscard]] const std::vector<std::pair<T, BitCode>> &getCodes() const { return codes; }
+  [[nodiscard]] const std::array<BitCode, ValueCount<T>> &getCodeTable() const { return codeTable; }
+  [[nodiscard]] const DecodingTable &getDecodingTable() const { return decodingTable; }
+
+  /**
+   * @return binary representation of dictionary, @see readStaticDictionary
+   */
+  [[nodiscard]] std::vector<uint8_t> serialize() const {
+    auto sink = VectorSink{};
+    auto writer = BitWriter{sink};
+    writer.pushBytes(id);
+    writer.flush();
+    writeToSink(sink, std::array{std::span<const uint8_t>{header}});
+    return sink.releaseData();
+  }
+
+ private:
+  static std::vector<uint8_t> createHeader(const std::vector<std::pair<T, BitCode>> &symbolCodes) {
+    auto sink = VectorSink{};
+    auto writer = BitWriter{sink};
+    detail::writeStaticHeader(symbolCodes, 0, writer);
+    writer.flush();
+    return sink.releaseData();
+  }
+
+  static DecodingTable createDecodingTable(const std::vector<std::pair<T, BitCode>> &symbolCodes) {
+    auto lengthCounts = std::vector<std::size_t>(symbolCodes.back().second.size());
+    auto symbols = std::vector<std::size_t>{};
+    std::ranges::for_each(symbolCodes, [&](const auto &symbolCode) {
+      ++lengthCounts[symbolCode.second.size() - 1];
+      symbols.emplace_back(static_cast<std::make_unsigned_t<T>>(symbolCode.first));
+    });
+    return DecodingTable{lengthCounts, symbols};
+  }
+
+  static uint32_t hash(std::span<const uint8_t> data) {
+    auto result = uint32_t{2166136261};
+    std::ranges::for_each(data, [&](const auto byte) { result = (result ^ byte) * 16777619; });
+    return result;
+  }
+
+  std::vector<std::pair<T, BitCode>> codes;
+  std::array<BitCode, ValueCount<T>> codeTable;
+  std::vector<uint8_t> header;
+  DecodingTable decodingTable;
+  uint32_t id;
+};
+
+/**
+ * Train dictionary on sample data.
+ * @details Every symbol gets a code, even if it's not present in samples.
+ * @param samples range of sample inputs, each of them is transformed by its own copy of model
+ * @param model model used during encoding
+ * @param maxCodeLength maximum length of a code in bits, 0 for the longest code supported by DecodingTable
+ * @return unexpected when codes can't be built or decoded, otherwise trained dictionary
+ */
+template<std::integral T>
+tl::expected<StaticDictionary<T>, std::string> trainStaticDictionary(const std::ranges::forward_range auto &samples,
+                                                                     Model<T> auto &&model,
+                                                                     std::size_t maxCodeLength = 0) {
+  auto histogram = Histogram<T>{};
+  std::ranges::fill(histogram, 1);
+  std::ranges::for_each(samples, [&](const auto &sample) {
+    const auto sampleHistogram = createHistogram<T>(sample, std::remove_cvref_t<decltype(model)>{model});
+    std::ranges::transform(histogram, sampleHistogram, histogram.begin(), std::plus{});
+  });
+  spdlog::info("Created histogram of samples");
+  // skewed samples would get codes longer than the decoder supports
+  if (maxCodeLength == 0) { maxCodeLength = DecodingTable::MAX_CODE_LENGTH; }
+  try {
+    return StaticDictionary<T>{buildCanonicalCodes<T>(histogram, maxCodeLength)};
+  } catch (const std::invalid_argument &e) { return tl::make_unexpected(e.what()); }
+}
+
+/**
+ * Read dictionary created via StaticDictionary::serialize.
+ * @param data serialized dictionary
+ * @return unexpected when data are malformed, otherwise dictionary
+ */
+template<std::integral T>
+tl::expected<StaticDictionary<T>, std::string> readStaticDictionary(std::span<const uint8_t> data) {
+  auto reader = BitReader{data};
+  const auto id = detail::readLittleEndian<uint32_t>(reader);
+  if (reader.isOverrun()) { return tl::make_unexpected("Not enough data"); }
+  const auto header = detail::readStaticHeader(data.subspan(sizeof(uint32_t)));
+  if (!header.has_value()) { return tl::make_unexpected(header.error()); }
+
+  auto codes = std::vector<std::pair<T, BitCode>>{};
+  auto symbol = header->symbols.begin();
+  for (std::size_t length = 1; length <= header->lengthCounts.size(); ++length) {
+    for (std::size_t i = 0; i < header->lengthCounts[length - 1] && symbol != header->symbols.end(); ++i) {
+      codes.emplace_back(static_cast<T>(*symbol++), BitCode{0, static_cast<uint8_t>(length)});
+    }
+  }
+  if (codes.empty()) { return tl::make_unexpected("Dictionary contains no codes"); }
+  assignCanonicalCodes(codes);
+  try {
+    auto dictionary = StaticDictionary<T>{std::move(codes)};
+    if (dictionary.getId() != id) { return tl::make_unexpected("Dictionary id doesn't match its content"); }
+    return dictionary;
+  } catch (const std::invalid_argument &e) { return tl::make_unexpected(e.what()); }
+}
+
+/**
+ * Encode data with codes of a dictionary.
+ * @details Stream consists of DICTIONARY_STREAM_MARKER, dictionary id (uint32_t), amount of symbols (uint64_t) and
+ * codes of symbols. The marker tells a decoder of static streams, that the stream requires a dictionary.
+ * @param data data to be encoded, it isn't modified as residuals of model are computed while they're encoded
+ * @param model
+ * @param dictionary codes of symbols, it has to contain all symbols of data after model is applied
+ * @param sink destination of encoded data
+ */
+template<std::integral T>
+void encodeStaticWithDictionary(const std::ranges::forward_range auto &data, Model<T> auto &&model,
+                                const StaticDictionary<T> &dictionary, ByteSink auto &sink) {
+  const auto &codeTable = dictionary.getCodeTable();
+  auto binEncoderData = BitWriter{sink};
+  binEncoderData.pushBytes(DICTIONARY_STREAM_MARKER);
+  binEncoderData.pushBytes(dictionary.getId());
+  binEncoderData.pushBytes(static_cast<uint64_t>(std::ranges::distance(data)));
+  detail::emitResidualCodes<T>(data, model, codeTable, dictionary.getCodes().back().second.size(), binEncoderData);
+  binEncoderData.flush();
+}
+
+/**
+ * Encoding to memory, @see encodeStaticWithDictionary above.
+ * @return encoded data
+ */
+template<std::integral T>
+std::vector<uint8_t> encodeStaticWithDictionary(const std::ranges::forward_range auto &data, Model<T> auto &&model,
+                                                const StaticDictionary<T> &dictionary) {
+  auto sink = VectorSink{};
+  encodeStaticWithDictionary<T>(data, model, dictionary, sink);
+  return sink.releaseData();
+}
+
+/**
+ * Decode data encoded via @see encodeStaticWithDictionary<T> function.
+ * @param data input data
+ * @param dictionary dictionary used during encoding
+ * @param model model used during encoding
+ * @return unexpected when error occurs, otherwise decoded data
+ */
+template<std::integral T>
+tl::expected<std::vector<T>, std::string> decodeStaticWithDictionary(std::ranges::contiguous_range auto &&data,
+                                                                     const StaticDictionary<T> &dictionary,
+                                                                     Model<T> auto &&model) {
+  auto reader = BitReader{std::span<const uint8_t>{std::ranges::data(data), std::ranges::size(data)}};
+  const auto marker = detail::readLittleEndian<uint8_t>(reader);
+  const auto id = detail::readLittleEndian<uint32_t>(reader);
+  const auto symbolCount = detail::readLittleEndian<uint64_t>(reader);
+  if (reader.isOverrun()) { return tl::make_unexpected("Not enough data"); }
+  if (marker != DICTIONARY_STREAM_MARKER) { return tl::make_unexpected("Data not encoded with a static dictionary"); }
+  if (id != dictionary.getId()) {
+    return tl::make_unexpected(fmt::format("Data encoded with dictionary {:08x}, got {:08x}", id, dictionary.getId()));
+  }
+  // each symbol takes at least one bit
+  if (symbolCount > reader.size()) { return tl::make_unexpected("File size doesn't match data"); }
+
+  auto result = std::vector<T>(symbolCount);
+  const auto decoded = detail::decodeStaticSymbols(reader, dictionary.getDecodingTable(), std::span<T>{result});
+  if (!decoded.has_value()) { return tl::make_unexpected(decoded.error()); }
+  std::ranges::transform(result, std::ranges::begin(result), makeRevertLambda<T>(model));
+  return result;
+}
+}// namespace pf::kko
+
+#endif//HUFF_CODEC__STATIC_DICTIONARY_H
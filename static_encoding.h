@@ -8,211 +8,674 @@
 #ifndef PF_HUFF_CODEC__COMPRESSION_H
 #define PF_HUFF_CODEC__COMPRESSION_H
 
-#include "BinaryEncoder.h"
-#include "EncodingTreeData.h"
-#include "Tree.h"
+#include "BitWriter.h"
+#include "View2D.h"
 #include "constants.h"
+#include "histogram.h"
 #include "models.h"
+#include "parallel.h"
+#include "static_common.h"
 #include "utils.h"
 #include <algorithm>
+#include <array>
+#include <cassert>
 #include <concepts>
-#include <queue>
+#include <cstring>
+#include <functional>
+#include <numeric>
 #include <ranges>
+#include <span>
 #include <spdlog/spdlog.h>
+#include <tl/expected.hpp>
 #include <vector>
 
 namespace pf::kko {
 
-template<std::integral T>
-std::array<std::size_t, ValueCount<T>> createHistogram(const std::ranges::forward_range auto &data) {
-  auto result = std::array<std::size_t, ValueCount<T>>{};
-  std::ranges::for_each(data, [&result](const auto value) { ++result[value]; });
-  return result;
+namespace detail {
+/**
+ * Push codes of data to writer, BatchSize codes are joined into a single push.
+ * @tparam BatchSize amount of codes joined together, their total length must not exceed 64 bits
+ * @param data input data
+ * @param codeTable code for each symbol value
+ * @param writer destination of codes
+ */
+template<std::size_t BatchSize>
+void emitCodes(std::ranges::forward_range auto &&data, const std::ranges::random_access_range auto &codeTable,
+               auto &writer) {
+  auto iter = std::ranges::begin(data);
+  const auto end = std::ranges::end(data);
+  if constexpr (BatchSize > 1) {
+    for (auto remaining = std::ranges::distance(data); remaining >= static_cast<decltype(remaining)>(BatchSize);
+         remaining -= BatchSize) {
+      auto bits = uint64_t{};
+      auto length = std::size_t{};
+      for (std::size_t i = 0; i < BatchSize; ++i, ++iter) {
+        const auto &code = codeTable[*iter];
+        bits = (bits << code.length) | code.bits;
+        length += code.length;
+      }
+      writer.pushBits(bits, length);
+    }
+  }
+  for (; iter != end; ++iter) { writer.pushBits(codeTable[*iter]); }
 }
 
 /**
- * Create a huffman tree for encoding purposes.
- * @details stl heap functions are used for code simplification
- * @param histogram histogram of occurrences in input data
- * @return binary tree, where leaves represent symbols
+ * Sink for a part of a stream encoded on its own thread, @see encodeStaticParallel_impl.
+ * @details The first word may be shared with the previous part, so it goes to a separate buffer and it's merged after
+ * all parts are encoded. The following words go directly to the stream memory. The last word may reach past the end of
+ * the memory, it goes to a tail buffer and only the bytes fitting into the memory are copied on finish.
  */
-template<std::integral T>
-Tree<StaticEncodingTreeData<T>> buildTree(const std::ranges::forward_range auto &histogram) {
-  using NodeType = Node<StaticEncodingTreeData<T>>;
-  // comparison function dereferencing ptrs
-  const auto compare = [](const auto &lhs, const auto &rhs) { return *lhs > *rhs; };
-
-  auto treeHeap = std::vector<std::unique_ptr<NodeType>>{};
-
-  // counter representing an encoded symbol, could be replaced with ranges library (histogram | views::enumerate)
-  std::integral auto counter = T{};
-  std::ranges::for_each(histogram, [&treeHeap, &counter, compare](const auto &occurrenceCnt) {
-    if (occurrenceCnt > 0) {
-      pushAsHeap(treeHeap, makeUniqueNode(StaticEncodingTreeData<T>{counter, occurrenceCnt, true}), compare);
+class PartSink {
+ public:
+  using size_type = std::size_t;
+  /**
+   * @param firstWord memory for the first word of the part
+   * @param memory stream memory following the first word up to the end of the part's last word
+   */
+  PartSink(std::span<uint8_t> firstWord, std::span<uint8_t> memory) : firstWord(firstWord), memory(memory) {}
+
+  [[nodiscard]] std::span<uint8_t> next(size_type writtenBytes, size_type minSize) {
+    assert(!isTailUsed && minSize <= tail.size());
+    if (!isFirstWordUsed) {
+      isFirstWordUsed = true;
+      return firstWord;
     }
-    ++counter;
-  });
-  // if the tree only has one element, add special node
-  if (treeHeap.size() == 1) { pushAsHeap(treeHeap, makeUniqueNode(makeNYTStatic<T>()), compare); }
-  // heap transformation to a binary tree
-  while (treeHeap.size() > 1) {
-    auto left = popAsHeap(treeHeap, compare);
-    auto right = popAsHeap(treeHeap, compare);
-    auto newNode = makeUniqueNode(StaticEncodingTreeData<T>{0, left->getValue().weight + right->getValue().weight, true});
-    newNode->setLeft(std::move(left));
-    newNode->setRight(std::move(right));
-    treeHeap.emplace_back(std::move(newNode));
-    std::push_heap(treeHeap.begin(), treeHeap.end(), compare);
-  }
-  auto result = Tree<StaticEncodingTreeData<T>>();
-  result.setRoot(std::move(treeHeap.front()));
-  return result;
-}
+    if (!isMemoryUsed) {
+      isMemoryUsed = true;
+      if (memory.size() >= minSize) { return memory; }
+      writtenBytes = 0;
+    }
+    memoryBytes = writtenBytes;
+    isTailUsed = true;
+    return tail;
+  }
+
+  void finish(size_type writtenBytes) {
+    if (!isTailUsed) { return; }
+    std::copy_n(tail.begin(), std::min(writtenBytes, memory.size() - memoryBytes), memory.begin() + memoryBytes);
+  }
+
+ private:
+  std::span<uint8_t> firstWord;
+  std::span<uint8_t> memory;
+  std::array<uint8_t, sizeof(uint64_t)> tail{};
+  size_type memoryBytes{};
+  bool isFirstWordUsed = false;
+  bool isMemoryUsed = false;
+  bool isTailUsed = false;
+};
+static_assert(ByteSink<PartSink>);
 
 /**
- * Implementation of huffman code creation.
- * @param node currently inspected node
- * @param codesForSymbols storage for results
- * @param branchCode code from the previous levels of the tree
+ * @return code for each symbol value, symbols without a code have an empty one
  */
 template<std::integral T>
-void buildCodes(Node<StaticEncodingTreeData<T>> &node, std::vector<std::pair<T, std::vector<bool>>> &codesForSymbols,
-                const std::vector<bool> &branchCode) {
-  if (node.isLeaf()) {
-    codesForSymbols.template emplace_back(node->value, branchCode);
-    return;
-  }
-  auto leftCode = branchCode;
-  auto rightCode = branchCode;
-  leftCode.template emplace_back(false);
-  rightCode.template emplace_back(true);
-  if (node.hasLeft()) { buildCodes(node.getLeft(), codesForSymbols, leftCode); }
-  if (node.hasRight()) { buildCodes(node.getRight(), codesForSymbols, rightCode); }
+std::array<BitCode, ValueCount<T>> createCodeTable(const std::vector<std::pair<T, BitCode>> &symbolCodes) {
+  auto codeTable = std::array<BitCode, ValueCount<T>>{};
+  std::ranges::for_each(symbolCodes, [&](const auto &symbolCode) { codeTable[symbolCode.first] = symbolCode.second; });
+  return codeTable;
 }
 
 /**
- * Create huffman code for each symbol.
- * @param node tree root node
- * @return vector of pairs, where pair.first is a symbol and pair.second is binary code
+ * @return total length of codes of all symbols in histogram in bits
  */
-template<std::integral T>
-std::vector<std::pair<T, std::vector<bool>>> buildCodes(Node<StaticEncodingTreeData<T>> &node) {
-  auto result = std::vector<std::pair<T, std::vector<bool>>>{};
-  buildCodes(node, result, {});
-  return result;
+std::size_t countPayloadBits(const std::ranges::forward_range auto &histogram,
+                             const std::ranges::random_access_range auto &codeTable) {
+  auto payloadBitSize = std::size_t{};
+  auto symbol = std::size_t{};
+  std::ranges::for_each(histogram, [&](const auto count) { payloadBitSize += count * codeTable[symbol++].length; });
+  return payloadBitSize;
 }
 
 /**
- * Make code canonical in order to save some data space
- * @param codes codes from buildCodes function
+ * Offset of padding info in header of static stream.
+ */
+constexpr std::size_t PADDING_INFO_OFFSET = 1;
+
+/**
+ * @param symbolCodes huffman codes for symbol
+ * @param payloadBitSize length of encoded data in bits
+ * @return padding info byte of header, @see writeStaticHeader
  */
 template<std::integral T>
-void transformCodes(std::vector<std::pair<T, std::vector<bool>>> &codes) {
-  // sort the symbols by their code length
-  std::ranges::sort(codes, [](const auto &lhs, const auto &rhs) { return lhs.second.size() < rhs.second.size(); });
+uint8_t createPaddingInfo(const std::vector<std::pair<T, BitCode>> &symbolCodes, std::size_t payloadBitSize) {
+  const auto minCodeLength =
+      std::ranges::min(symbolCodes | std::views::transform([](const auto &el) { return el.second.size(); }));
+  const auto padding = (8 - payloadBitSize % 8) % 8;
+  return static_cast<uint8_t>((minCodeLength - 1) | (static_cast<uint8_t>(padding << PADDING_SHIFT)));
+}
 
-  auto &[unused1_, shortestCode] = codes.front();
-  const auto shortestCodeLen = shortestCode.size();
+/**
+ * Write header of static stream: code length info, padding info, amount of codes of each length and symbols in
+ * canonical order. Header always consists of whole bytes.
+ * @param symbolCodes huffman codes for symbol
+ * @param payloadBitSize length of encoded data in bits
+ * @param writer destination of header
+ * @param flags flags stored in the upper bits of code length info
+ */
+template<std::integral T>
+void writeStaticHeader(const std::vector<std::pair<T, BitCode>> &symbolCodes, std::size_t payloadBitSize,
+                       auto &writer, uint8_t flags = 0) {
+  const auto [minCodeLength, maxCodeLength] =
+      minmaxValue(symbolCodes | std::views::transform([](const auto &el) { return el.second.size(); })).value();
 
-  shortestCode.clear();
-  shortestCode.resize(shortestCodeLen, false);
+  auto byteHeader = std::vector<std::vector<uint8_t>>{};
+  byteHeader.resize(maxCodeLength + 1);
+  std::ranges::for_each(symbolCodes, [&](const auto &symbolCode) {
+    const auto &[symbol, code] = symbolCode;
+    byteHeader[code.size()].emplace_back(symbol);
+  });
+  spdlog::info("Created header");
 
-  if (codes.size() <= 1) { return; }
+  const auto codeLengthInfo = static_cast<uint8_t>((maxCodeLength + 1) | flags);
 
-  auto &[unused2_, secondShortestCode] = codes[1];
-  const auto secondShortestCodeOrigLen = secondShortestCode.size();
-  auto previousCodeLen = secondShortestCodeOrigLen;
-  auto previousCode = 1 << (secondShortestCodeOrigLen - shortestCodeLen);
+  writer.pushBits(codeLengthInfo, 8);
+  writer.pushBits(createPaddingInfo(symbolCodes, payloadBitSize), 8);
+  std::ranges::for_each(byteHeader.begin() + minCodeLength, byteHeader.end(),
+                        [&writer](const auto &v) { writer.pushBits(static_cast<uint8_t>(v.size()), 8); });
+  std::ranges::for_each(byteHeader, [&writer](const auto &symbols) {
+    std::ranges::for_each(symbols, [&writer](auto symbol) { writer.pushBits(symbol, 8); });
+  });
+}
 
-  const auto fillWithZerosAndOnePadAndReverse = [](auto &vec, auto mask, auto padLen) {
-    for (; mask != 0; mask >>= 1) { vec.template emplace_back(mask & 1); }
-    std::ranges::generate_n(std::back_inserter(vec), padLen - vec.size(), [] { return false; });
-    std::reverse(vec.begin(), vec.end());
-  };
+/**
+ * Push codes of data to writer, the amount of codes joined into a single push is chosen by maximum code length.
+ */
+void emitAllCodes(std::ranges::forward_range auto &&data, const std::ranges::random_access_range auto &codeTable,
+                  std::size_t maxCodeLength, auto &writer) {
+  // as many codes as fit into 64 bits are pushed at once
+  if (maxCodeLength <= 8) {
+    detail::emitCodes<8>(data, codeTable, writer);
+  } else if (maxCodeLength <= 16) {
+    detail::emitCodes<4>(data, codeTable, writer);
+  } else if (maxCodeLength <= 32) {
+    detail::emitCodes<2>(data, codeTable, writer);
+  } else {
+    detail::emitCodes<1>(data, codeTable, writer);
+  }
+}
 
-  secondShortestCode.clear();
-  fillWithZerosAndOnePadAndReverse(secondShortestCode, previousCode, secondShortestCodeOrigLen);
+/**
+ * Push codes of residuals of model to writer, residuals are computed a block at a time and they aren't stored.
+ */
+template<std::integral T>
+void emitResidualCodes(std::ranges::forward_range auto &&data, Model<T> auto &model,
+                       const std::ranges::random_access_range auto &codeTable, std::size_t maxCodeLength,
+                       auto &writer) {
+  if constexpr (std::same_as<std::remove_cvref_t<decltype(model)>, IdentityModel<T>>) {
+    emitAllCodes(data, codeTable, maxCodeLength, writer);
+  } else {
+    forEachResidualBlock<T>(data, model, [&](std::span<const T> residuals) {
+      emitAllCodes(residuals, codeTable, maxCodeLength, writer);
+    });
+  }
+}
 
-  for (std::size_t cnt = 2; cnt < codes.size(); ++cnt) {
-    auto &symbol = codes[cnt];
-    const auto codeLen = symbol.second.size();
-    const auto code = (previousCode + 1) * (1 << (codeLen - previousCodeLen));
-    previousCodeLen = codeLen;
-    previousCode = code;
-    symbol.second.clear();
-    fillWithZerosAndOnePadAndReverse(symbol.second, code, codeLen);
+/**
+ * Push bits of a byte aligned stream to writer, a word at a time.
+ * @param stream source of bits, MSB first
+ * @param bitSize amount of bits pushed from the beginning of stream
+ * @param writer destination of bits
+ */
+void pushStream(std::span<const uint8_t> stream, std::size_t bitSize, auto &writer) {
+  const auto wordCount = bitSize / 64;
+  for (std::size_t i = 0; i < wordCount; ++i) {
+    auto word = uint64_t{};
+    std::memcpy(&word, stream.data() + i * sizeof(uint64_t), sizeof(uint64_t));
+    writer.pushBits(toBigEndian(word), 64);
+  }
+  for (auto bit = wordCount * 64; bit < bitSize; bit += 8) {
+    const auto length = std::min<std::size_t>(8, bitSize - bit);
+    writer.pushBits(stream[bit / 8] >> (8 - length), length);
   }
 }
+}// namespace detail
+
+/**
+ * Inputs larger than this are encoded on multiple threads by encodeStatic, if the sink provides memory of the whole
+ * stream, the histogram isn't sampled and the amount of threads isn't set in options.
+ */
+constexpr std::size_t PARALLEL_ENCODE_THRESHOLD = 4 * 1024 * 1024;
 
 /**
  * Encode data using prepared symbol codes.
+ * @details Size of encoded data is known from histogram, so the whole header is written before the data.
  * @param data input data
+ * @param model model applied to data while it's encoded
+ * @param histogram histogram of residuals of model
  * @param symbolCodes huffman codes for symbol
- * @return encoded data
+ * @param sink destination of encoded data
  */
 template<std::integral T>
-std::vector<uint8_t> encodeStatic_impl(std::ranges::forward_range auto &&data,
-                                       const std::vector<std::pair<T, std::vector<bool>>> &symbolCodes) {
-  const auto [minCodeLength, maxCodeLength] =
-      minmaxValue(symbolCodes | std::views::transform([](const auto &el) { return el.second.size(); })).value();
+void encodeStatic_impl(const std::ranges::forward_range auto &data, Model<T> auto &&model,
+                       const std::ranges::forward_range auto &histogram,
+                       const std::vector<std::pair<T, BitCode>> &symbolCodes, ByteSink auto &sink) {
+  const auto codeTable = detail::createCodeTable(symbolCodes);
+  const auto payloadBitSize = detail::countPayloadBits(histogram, codeTable);
+  spdlog::trace("Start binary encoding");
 
-  auto byteHeader = std::vector<std::vector<uint8_t>>{};
-  byteHeader.resize(maxCodeLength + 1);
-  auto byteTable = std::array<std::vector<bool>, ValueCount<T>>{};
+  auto binEncoderData = BitWriter{sink};
+  detail::writeStaticHeader(symbolCodes, payloadBitSize, binEncoderData);
+  detail::emitResidualCodes<T>(data, model, codeTable, symbolCodes.back().second.size(), binEncoderData);
+  spdlog::info("Data encoded, total length: {}[b]", binEncoderData.size());
+  binEncoderData.flush();
+}
 
-  std::ranges::for_each(symbolCodes, [&byteTable, &byteHeader](const auto &symbolCode) {
-    const auto &[symbol, code] = symbolCode;
-    byteTable[symbol] = code;
-    byteHeader[code.size()].emplace_back(symbol);
-  });
-  spdlog::info("Created header");
+/**
+ * Encode data using prepared symbol codes, which weren't built from a histogram of all data.
+ * @details Size of encoded data isn't known before encoding. Sinks which can patch data get the header with zero
+ * padding before the codes and padding info is overwritten once all codes are written. Other sinks get the codes
+ * written to memory and passed to the sink after the header.
+ * @param data input data
+ * @param model model applied to data while it's encoded
+ * @param symbolCodes huffman codes for symbol, there has to be a code for each residual of model
+ * @param sink destination of encoded data
+ * @param expectedPayloadSize expected size of encoded data in bytes, memory for it is allocated up front when codes are
+ * written to memory
+ */
+template<std::integral T, ByteSink Sink>
+void encodeStaticBuffered_impl(const std::ranges::forward_range auto &data, Model<T> auto &&model,
+                               const std::vector<std::pair<T, BitCode>> &symbolCodes, Sink &sink,
+                               std::size_t expectedPayloadSize = 0) {
+  const auto codeTable = detail::createCodeTable(symbolCodes);
   spdlog::trace("Start binary encoding");
 
-  auto binEncoderData = BinaryEncoder<uint8_t>{};
+  if constexpr (PatchableByteSink<Sink>) {
+    if (sink.canPatch()) {
+      const auto headerOffset = sink.size();
+      auto binEncoderData = BitWriter{sink};
+      detail::writeStaticHeader(symbolCodes, 0, binEncoderData);
+      const auto headerBitSize = binEncoderData.size();
+      detail::emitResidualCodes<T>(data, model, codeTable, symbolCodes.back().second.size(), binEncoderData);
+      const auto payloadBitSize = binEncoderData.size() - headerBitSize;
+      spdlog::info("Data encoded, total length: {}[b]", binEncoderData.size());
+      binEncoderData.flush();
+      sink.patch(headerOffset + detail::PADDING_INFO_OFFSET, detail::createPaddingInfo(symbolCodes, payloadBitSize));
+      return;
+    }
+  }
+
+  auto payloadSink = VectorSink{expectedPayloadSize};
+  auto payloadWriter = BitWriter{payloadSink};
+  detail::emitResidualCodes<T>(data, model, codeTable, symbolCodes.back().second.size(), payloadWriter);
+  const auto payloadBitSize = payloadWriter.size();
+  payloadWriter.flush();
+  const auto payload = payloadSink.releaseData();
+
+  auto binEncoderData = BitWriter{sink};
+  detail::writeStaticHeader(symbolCodes, payloadBitSize, binEncoderData);
+  spdlog::info("Data encoded, total length: {}[b]", binEncoderData.size() + payloadBitSize);
+  binEncoderData.flush();
+  writeToSink(sink, std::array{std::span<const uint8_t>{payload}});
+}
+
+/**
+ * Encode data using prepared symbol codes on multiple threads, output is the same as the output of encodeStatic_impl.
+ * @details Input is split into parts of similar size. Bit length of each part's codes is known from its histogram and
+ * exclusive prefix sum of those lengths gives the bit offset of each part in the stream, so all parts are encoded in
+ * parallel directly into memory of the whole stream provided by the sink. Words shared by two parts are merged at the
+ * end. Sinks which can't provide memory of the whole stream at once get it copied from a buffer. Residuals of each part
+ * are computed by its own model.
+ * @param data input data
+ * @param partModels model for each part of data (@see splitRange) in the state after all previous parts, their amount
+ * is the amount of threads
+ * @param partHistograms histogram of residuals of each part
+ * @param symbolCodes huffman codes for symbol
+ * @param sink destination of encoded data
+ */
+template<std::integral T, typename M, ByteSink Sink>
+void encodeStaticParallel_impl(const std::ranges::random_access_range auto &data, const std::vector<M> &partModels,
+                               const std::vector<Histogram<T>> &partHistograms,
+                               const std::vector<std::pair<T, BitCode>> &symbolCodes, Sink &sink) {
+  if constexpr (!ContiguousByteSink<Sink>) {
+    auto streamSink = VectorSink{};
+    encodeStaticParallel_impl(data, partModels, partHistograms, symbolCodes, streamSink);
+    writeToSink(sink, std::array{streamSink.releaseData()});
+  } else {
+    constexpr auto WORD_SIZE = sizeof(uint64_t);
+    const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+    const auto threadCount = partModels.size();
+    const auto codeTable = detail::createCodeTable(symbolCodes);
+    const auto maxCodeLength = symbolCodes.back().second.size();
+
+    auto partOffsets = std::vector<std::size_t>(threadCount + 1);
+    std::ranges::transform(partHistograms, partOffsets.begin() + 1, [&codeTable](const auto &histogram) {
+      return detail::countPayloadBits(histogram, codeTable);
+    });
+    const auto payloadBitSize = std::accumulate(partOffsets.begin(), partOffsets.end(), std::size_t{});
+    spdlog::trace("Start binary encoding");
+
+    auto headerSink = VectorSink{};
+    auto headerWriter = BitWriter{headerSink};
+    detail::writeStaticHeader(symbolCodes, payloadBitSize, headerWriter);
+    headerWriter.flush();
+    const auto header = headerSink.releaseData();
+    partOffsets[0] = header.size() * 8;
+    std::partial_sum(partOffsets.begin(), partOffsets.end(), partOffsets.begin());
 
-  std::ranges::for_each(byteHeader.begin() + minCodeLength, byteHeader.end(), [&binEncoderData](const auto &v) {
-    const auto size = static_cast<uint8_t>(v.size());
-    binEncoderData.pushBack(size);
+    const auto totalBytes = (partOffsets.back() + 7) / 8;
+    const auto stream = sink.next(0, totalBytes).first(totalBytes);
+    const auto getWordOffset = [&](std::size_t index) { return partOffsets[index] / 64 * WORD_SIZE; };
+    // bytes of the first word following the header are merged with the first part, so they have to be zeros
+    std::ranges::fill(stream.subspan(0, std::min(getWordOffset(0) + WORD_SIZE, totalBytes)), 0);
+    std::ranges::copy(header, stream.begin());
+    auto firstWords = std::vector<std::array<uint8_t, WORD_SIZE>>(threadCount);
+    parallelFor(threadCount, [&](std::size_t index) {
+      const auto [begin, end] = splitRange(dataSize, threadCount, index);
+      const auto memoryBegin = std::min(getWordOffset(index) + WORD_SIZE, totalBytes);
+      const auto memoryEnd = index + 1 < threadCount ? std::min(getWordOffset(index + 1) + WORD_SIZE, totalBytes)
+                                                     : totalBytes;
+      auto partSink = detail::PartSink{firstWords[index], stream.subspan(memoryBegin, memoryEnd - memoryBegin)};
+      auto writer = BitWriter{partSink};
+      writer.pushBits(0, partOffsets[index] % 64);
+      auto partModel = partModels[index];
+      detail::emitResidualCodes<T>(std::ranges::subrange(std::ranges::begin(data) + static_cast<std::ptrdiff_t>(begin),
+                                                         std::ranges::begin(data) + static_cast<std::ptrdiff_t>(end)),
+                                   partModel, codeTable, maxCodeLength, writer);
+      writer.flush();
+    });
+    for (std::size_t index = 0; index < threadCount; ++index) {
+      const auto wordOffset = getWordOffset(index);
+      const auto firstWord = stream.subspan(wordOffset, std::min(WORD_SIZE, totalBytes - wordOffset));
+      std::ranges::transform(firstWord, firstWords[index], firstWord.begin(), std::bit_or{});
+    }
+    spdlog::info("Data encoded, total length: {}[b]", partOffsets.back());
+    sink.finish(totalBytes);
+  }
+}
+
+/**
+ * Encode data using prepared symbol codes, which weren't built from a histogram of all data, on multiple threads.
+ * @details Bit length of parts isn't known before they're encoded, so each part is encoded into its own memory. The
+ * header is written once all parts are encoded and each part is appended to the stream at the bit where the previous
+ * one ended.
+ * @param data input data
+ * @param partModels model for each part of data (@see splitRange) in the state after all previous parts, their amount
+ * is the amount of threads
+ * @param symbolCodes huffman codes for symbol, there has to be a code for each residual of model
+ * @param sink destination of encoded data
+ */
+template<std::integral T, typename M>
+void encodeStaticParallelBuffered_impl(const std::ranges::random_access_range auto &data,
+                                       const std::vector<M> &partModels,
+                                       const std::vector<std::pair<T, BitCode>> &symbolCodes, ByteSink auto &sink) {
+  const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+  const auto threadCount = partModels.size();
+  const auto codeTable = detail::createCodeTable(symbolCodes);
+  const auto maxCodeLength = symbolCodes.back().second.size();
+  spdlog::trace("Start binary encoding");
+
+  auto partStreams = std::vector<std::vector<uint8_t>>(threadCount);
+  auto partBitSizes = std::vector<std::size_t>(threadCount);
+  parallelFor(threadCount, [&](std::size_t index) {
+    const auto [begin, end] = splitRange(dataSize, threadCount, index);
+    auto partSink = VectorSink{};
+    auto writer = BitWriter{partSink};
+    auto partModel = partModels[index];
+    detail::emitResidualCodes<T>(std::ranges::subrange(std::ranges::begin(data) + static_cast<std::ptrdiff_t>(begin),
+                                                       std::ranges::begin(data) + static_cast<std::ptrdiff_t>(end)),
+                                 partModel, codeTable, maxCodeLength, writer);
+    partBitSizes[index] = writer.size();
+    writer.flush();
+    partStreams[index] = partSink.releaseData();
   });
-  std::ranges::for_each(byteHeader, [&binEncoderData](auto val) { binEncoderData.pushBack(val); });
-  std::ranges::for_each(data,
-                        [&binEncoderData, &byteTable](const auto &in) { binEncoderData.pushBack(byteTable[in]); });
 
-  const auto padding = binEncoderData.unusedBitsInCell();
-  const auto codeLengthInfo = static_cast<uint8_t>(maxCodeLength + 1);
-  const auto paddingInfo = static_cast<uint8_t>((minCodeLength - 1) | (static_cast<uint8_t>(padding << PADDING_SHIFT)));
+  auto binEncoderData = BitWriter{sink};
+  detail::writeStaticHeader(symbolCodes, std::accumulate(partBitSizes.begin(), partBitSizes.end(), std::size_t{}),
+                            binEncoderData);
+  for (std::size_t index = 0; index < threadCount; ++index) {
+    detail::pushStream(partStreams[index], partBitSizes[index], binEncoderData);
+  }
+  spdlog::info("Data encoded, total length: {}[b]", binEncoderData.size());
+  binEncoderData.flush();
+}
 
-  auto result = std::vector<uint8_t>{};
-  result.template emplace_back(codeLengthInfo);
-  result.template emplace_back(paddingInfo);
-  result.resize(result.size() + binEncoderData.data().size());
-  std::ranges::copy(binEncoderData.releaseData(), result.begin() + 2);
+/**
+ * Encode data using prepared symbol codes into INTERLEAVED_STREAM_COUNT streams sharing the same codes.
+ * @details Each stream contains a consecutive part of the data, so that a decoder can decode all of them at the same
+ * time. Header is followed by amount of symbols and byte sizes of all streams but the last one, all of them uint64_t,
+ * and the streams. Each stream is padded to whole bytes.
+ * @param data input data
+ * @param partModels model for each stream (@see splitRange) in the state after all previous streams
+ * @param symbolCodes huffman codes for symbol
+ * @param sink destination of encoded data
+ */
+template<std::integral T, typename M>
+void encodeStaticInterleaved_impl(const std::ranges::random_access_range auto &data, const std::vector<M> &partModels,
+                                  const std::vector<std::pair<T, BitCode>> &symbolCodes, ByteSink auto &sink) {
+  assert(partModels.size() == INTERLEAVED_STREAM_COUNT);
+  const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+  const auto codeTable = detail::createCodeTable(symbolCodes);
+  const auto maxCodeLength = symbolCodes.back().second.size();
+  spdlog::trace("Start binary encoding");
+
+  auto streams = std::array<std::vector<uint8_t>, INTERLEAVED_STREAM_COUNT>{};
+  for (std::size_t i = 0; i < INTERLEAVED_STREAM_COUNT; ++i) {
+    const auto [begin, end] = splitRange(dataSize, INTERLEAVED_STREAM_COUNT, i);
+    auto streamSink = VectorSink{};
+    auto writer = BitWriter{streamSink};
+    auto streamModel = partModels[i];
+    detail::emitResidualCodes<T>(std::ranges::subrange(std::ranges::begin(data) + static_cast<std::ptrdiff_t>(begin),
+                                                       std::ranges::begin(data) + static_cast<std::ptrdiff_t>(end)),
+                                 streamModel, codeTable, maxCodeLength, writer);
+    writer.flush();
+    streams[i] = streamSink.releaseData();
+  }
+
+  auto binEncoderData = BitWriter{sink};
+  detail::writeStaticHeader(symbolCodes, 0, binEncoderData, INTERLEAVED_STREAMS_FLAG);
+  binEncoderData.pushBytes(static_cast<uint64_t>(dataSize));
+  std::ranges::for_each(streams.begin(), streams.end() - 1,
+                        [&](const auto &stream) { binEncoderData.pushBytes(static_cast<uint64_t>(stream.size())); });
+  spdlog::info("Data encoded, total length: {}[b]",
+               std::accumulate(streams.begin(), streams.end(), binEncoderData.size(),
+                               [](auto sum, const auto &stream) { return sum + stream.size() * 8; }));
+  binEncoderData.flush();
+  writeToSink(sink, streams);
+}
+
+/**
+ * Options of static encoding.
+ */
+struct StaticEncodingOptions {
+  /**
+   * Maximum length of a symbol code in bits, 0 for unlimited. Limited codes are built by package-merge, so that
+   * a decoder can resolve each code with a single table lookup. 8 bits allow for all byte symbols.
+   */
+  std::size_t maxCodeLength = 0;
+  /**
+   * Amount of threads encoding the data, 0 for all available threads if the data are larger than
+   * PARALLEL_ENCODE_THRESHOLD, the sink is a ContiguousByteSink and the histogram isn't sampled, a single thread
+   * otherwise. Other sinks and sampled histograms get the whole stream buffered in memory when more threads are set.
+   * Output doesn't depend on the amount of threads.
+   */
+  std::size_t threadCount = 0;
+  /**
+   * Split data into INTERLEAVED_STREAM_COUNT streams, which are decoded at the same time. Data are always encoded on a
+   * single thread in this case.
+   */
+  bool interleaveStreams = false;
+  /**
+   * Build codes from a histogram of every histogramSampleStep-th row of data, 1 for a histogram of all data. Sampling
+   * reads a fraction of data at a cost of slightly longer output. Each symbol gets a code. Requires contiguous data.
+   */
+  std::size_t histogramSampleStep = 1;
+  /**
+   * Length of a sampled row, usually image width.
+   */
+  std::size_t histogramSampleRowWidth = 4096;
+};
 
-  spdlog::info("Data encoded, total length: {}[b]", result.size());
+namespace detail {
+/**
+ * Create histogram of residuals of model, sampled if options say so.
+ * @param data input data, it isn't modified
+ * @param model model applied to data, a copy of it is used
+ * @param options encoding options
+ */
+template<std::integral T, typename Model>
+Histogram<T> createStaticHistogram(const std::ranges::forward_range auto &data, const Model &model,
+                                   const StaticEncodingOptions &options) {
+  if (options.histogramSampleStep <= 1) { return createHistogram<T>(data, model); }
+  if constexpr (std::ranges::contiguous_range<decltype(data)>) {
+    return createSampledHistogram<T>(makeView2D<true>(data, options.histogramSampleRowWidth),
+                                     options.histogramSampleStep, model);
+  } else {
+    throw std::invalid_argument("Sampled histogram requires contiguous data");
+  }
+}
+
+/**
+ * Histograms and models of parts of data, @see createStaticHistogramOfParts.
+ */
+template<std::integral T, typename M>
+struct StaticHistogramOfParts {
+  // histogram used to build codes, sampled if options say so
+  Histogram<T> histogram;
+  // exact histogram of residuals of each part, empty when the histogram is sampled
+  std::vector<Histogram<T>> partHistograms;
+  // model of each part in the state after all previous parts
+  std::vector<M> partModels;
+};
+
+/**
+ * Create histogram of residuals of model, sampled if options say so, and a copy of model for each part of data. Parts
+ * get their own exact histogram, unless the histogram is sampled.
+ * @details Each part's model sees the value preceding the part first, which leaves it in the same state as running it
+ * over all previous parts, since models depend only on the previous value. So parts are independent of each other and
+ * they're counted in parallel, and a sampled histogram doesn't need the rest of data to be read.
+ * @param data input data, it isn't modified
+ * @param model model applied to data
+ * @param partCount amount of parts, @see splitRange
+ * @param options encoding options
+ */
+template<std::integral T, typename M>
+StaticHistogramOfParts<T, M> createStaticHistogramOfParts(const std::ranges::random_access_range auto &data,
+                                                          const M &model, std::size_t partCount,
+                                                          const StaticEncodingOptions &options) {
+  const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+  auto result = StaticHistogramOfParts<T, M>{.histogram = {},
+                                             .partHistograms = {},
+                                             .partModels = std::vector<M>(partCount, model)};
+  for (std::size_t index = 1; index < partCount; ++index) {
+    const auto begin = splitRange(dataSize, partCount, index).first;
+    [[maybe_unused]] const auto warmUp =
+        result.partModels[index].apply(std::ranges::begin(data)[static_cast<std::ptrdiff_t>(begin) - 1]);
+  }
+  if (options.histogramSampleStep > 1) {
+    result.histogram = createStaticHistogram<T>(data, model, options);
+    return result;
+  }
+
+  result.partHistograms.resize(partCount);
+  parallelFor(partCount, [&](std::size_t index) {
+    const auto [begin, end] = splitRange(dataSize, partCount, index);
+    const auto part = std::ranges::subrange(std::ranges::begin(data) + static_cast<std::ptrdiff_t>(begin),
+                                            std::ranges::begin(data) + static_cast<std::ptrdiff_t>(end));
+    if constexpr (std::same_as<M, IdentityModel<T>> && sizeof(T) == 1 && ByteRange<decltype(part)>) {
+      result.partHistograms[index] = createHistogramWordWise<T>(
+          {reinterpret_cast<const uint8_t *>(std::ranges::data(part)), std::ranges::size(part)});
+    } else if constexpr (std::same_as<M, IdentityModel<T>>) {
+      result.partHistograms[index] = createHistogramMultiWay<T>(part);
+    } else {
+      auto partModel = result.partModels[index];
+      result.partHistograms[index] = createResidualHistogram<T>(part, partModel);
+    }
+  });
+  std::ranges::for_each(result.partHistograms, [&result](const auto &partHistogram) {
+    std::ranges::transform(result.histogram, partHistogram, result.histogram.begin(), std::plus{});
+  });
   return result;
 }
+}// namespace detail
 
 /**
- * @details Model is a concept for the sake of optimisations
+ * @details Model is a concept for the sake of optimisations. Data is never modified and residuals of model aren't
+ * stored - they're computed a block at a time for the histogram and again while they're encoded. So data can be e.g.
+ * std::span<const T> over read-only memory.
  * @param data data to be encoded
  * @param model
- * @return encoded data
+ * @param sink destination of encoded data
+ * @param options encoding options
  */
-template<std::integral T, typename Model = IdentityModel<T>>
-std::vector<uint8_t> encodeStatic(std::ranges::forward_range auto &&data, Model &&model = Model{}) {
+template<std::integral T, typename Model>
+void encodeStatic(const std::ranges::forward_range auto &data, Model &&model, ByteSink auto &sink,
+                  const StaticEncodingOptions &options = {}) {
+  using ModelType = std::remove_cvref_t<Model>;
   spdlog::info("Starting static encoding");
-  std::ranges::transform(data, std::ranges::begin(data), makeApplyLambda<T>(model));
-  spdlog::trace("Applied model");
-  const auto histogram = createHistogram<uint8_t>(data);
+  const auto isSampled = options.histogramSampleStep > 1;
+
+  if constexpr (std::ranges::random_access_range<decltype(data)>) {
+    const auto dataSize = static_cast<std::size_t>(std::ranges::size(data));
+    const auto threadCount = options.threadCount != 0 ? options.threadCount
+        : ContiguousByteSink<std::remove_cvref_t<decltype(sink)>> && !isSampled
+            && dataSize >= PARALLEL_ENCODE_THRESHOLD
+        ? defaultThreadCount()
+        : 1;
+    if (options.interleaveStreams || threadCount > 1) {
+      const auto partCount = options.interleaveStreams
+          ? INTERLEAVED_STREAM_COUNT
+          : std::clamp<std::size_t>(threadCount, 1, std::max<std::size_t>(1, dataSize / 4096));
+      const auto [histogram, partHistograms, partModels] =
+          detail::createStaticHistogramOfParts<T>(data, ModelType{model}, partCount, options);
+      spdlog::trace("Created histogram");
+      const auto symbolCodes = buildCanonicalCodes<T>(histogram, options.maxCodeLength);
+      spdlog::info("Created symbol codes");
+      if (options.interleaveStreams) {
+        encodeStaticInterleaved_impl(data, partModels, symbolCodes, sink);
+      } else if (isSampled) {
+        encodeStaticParallelBuffered_impl(data, partModels, symbolCodes, sink);
+      } else {
+        encodeStaticParallel_impl(data, partModels, partHistograms, symbolCodes, sink);
+      }
+      return;
+    }
+  }
+  if (options.interleaveStreams) { throw std::invalid_argument("Interleaved streams require random access data"); }
+
+  const auto histogram = detail::createStaticHistogram<T>(data, model, options);
   spdlog::trace("Created histogram");
-  auto tree = buildTree<T>(histogram);
-  spdlog::info("Built tree");
-  auto symbolCodes = buildCodes(tree.getRoot());
-  spdlog::trace("Built codes");
-  transformCodes(symbolCodes);
+  const auto symbolCodes = buildCanonicalCodes<T>(histogram, options.maxCodeLength);
   spdlog::info("Created symbol codes");
+  auto encodingModel = ModelType{model};
+  if (isSampled) {
+    // sampled histogram is scaled down by about the sample step, a small margin avoids reallocation for most inputs
+    const auto expectedPayloadBits =
+        detail::countPayloadBits(histogram, detail::createCodeTable(symbolCodes)) * options.histogramSampleStep;
+    encodeStaticBuffered_impl(data, encodingModel, symbolCodes, sink,
+                              expectedPayloadBits / 8 + expectedPayloadBits / 128);
+    return;
+  }
+  encodeStatic_impl(data, encodingModel, histogram, symbolCodes, sink);
+}
 
-  return encodeStatic_impl(data, symbolCodes);
+/**
+ * Encoding to memory, @see encodeStatic above.
+ * @return encoded data
+ */
+template<std::integral T, typename Model = IdentityModel<T>>
+std::vector<uint8_t> encodeStatic(const std::ranges::forward_range auto &data, Model &&model = Model{},
+                                  const StaticEncodingOptions &options = {}) {
+  auto sink = VectorSink{};
+  encodeStatic<T>(data, std::forward<Model>(model), sink, options);
+  return sink.releaseData();
+}
+
+/**
+ * Encoding to caller owned memory, @see encodeStatic above.
+ * @param output memory for encoded data, its content is unspecified when an error occurs
+ * @return unexpected when output is too small, otherwise amount of bytes written
+ */
+template<std::integral T, typename Model = IdentityModel<T>>
+tl::expected<std::size_t, std::string> encodeStaticInto(const std::ranges::forward_range auto &data,
+                                                        std::span<uint8_t> output, Model &&model = Model{},
+                                                        const StaticEncodingOptions &options = {}) {
+  auto sink = SpanSink{output};
+  try {
+    encodeStatic<T>(data, std::forward<Model>(model), sink, options);
+  } catch (const std::length_error &e) { return tl::make_unexpected(e.what()); }
+  return sink.size();
 }
 }// namespace pf::kko
 
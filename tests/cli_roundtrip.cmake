@@ -0,0 +1,39 @@
+# Compress and decompress a generated image by huff_codec and check that the result matches the input.
+# Usage: cmake -DHUFF_CODEC=<path to huff_codec> -DWORK_DIR=<directory for files> -DARGS=<codec arguments> -P ...
+
+set(input "${WORK_DIR}/input.raw")
+set(encoded "${WORK_DIR}/encoded.bin")
+set(decoded "${WORK_DIR}/decoded.raw")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+# 256 rows of 512 pixels - smooth gradients with a pattern differing row by row
+set(row "")
+foreach (x RANGE 0 511)
+    math(EXPR value "48 + (${x} / 8) % 64")
+    string(ASCII ${value} pixel)
+    string(APPEND row "${pixel}")
+endforeach ()
+set(image "")
+foreach (y RANGE 0 255)
+    math(EXPR shift "${y} % 37")
+    string(SUBSTRING "${row}" ${shift} -1 head)
+    string(SUBSTRING "${row}" 0 ${shift} tail)
+    string(APPEND image "${head}${tail}")
+endforeach ()
+file(WRITE "${input}" "${image}")
+
+separate_arguments(args UNIX_COMMAND "${ARGS}")
+execute_process(COMMAND "${HUFF_CODEC}" -c ${args} -w 512 -i "${input}" -o "${encoded}" OUTPUT_QUIET
+                RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Compression failed: ${result}")
+endif ()
+execute_process(COMMAND "${HUFF_CODEC}" -d ${args} -w 512 -i "${encoded}" -o "${decoded}" OUTPUT_QUIET
+                RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Decompression failed: ${result}")
+endif ()
+execute_process(COMMAND "${CMAKE_COMMAND}" -E compare_files "${input}" "${decoded}" RESULT_VARIABLE result)
+if (NOT result EQUAL 0)
+    message(FATAL_ERROR "Decompressed data don't match input for arguments: ${ARGS}")
+endif ()
@@ -9,11 +9,17 @@
 #define HUFF_CODEC__UTILS_H
 
 #include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
 #include <experimental/memory>
 #include <filesystem>
 #include <fstream>
 #include <numeric>
+#include <optional>
+#include <type_traits>
 #include <cmath>
+#include <vector>
 
 namespace std {
 template<typename T>
@@ -73,29 +79,58 @@ std::optional<std::pair<std::ranges::range_value_t<R>, std::ranges::range_value_
 /* clang-format on */
 
 /**
- * Inefficient conversion of T to std::vector<bool>, which is its bit representation.
+ * Binary code of at most 64 bits. The last bit of the code is stored in the least significant bit of 'bits'.
+ */
+struct BitCode {
+  constexpr static std::size_t MAX_LENGTH = 64;
+  uint64_t bits{};
+  uint8_t length{};
+
+  /**
+   * @return code extended by one bit at the end
+   */
+  [[nodiscard]] constexpr BitCode append(bool bit) const {
+    return {(bits << 1) | (bit ? 1 : 0), static_cast<uint8_t>(length + 1)};
+  }
+  /**
+   * @return code extended by another code at the end, sum of lengths has to be at most 64
+   */
+  [[nodiscard]] constexpr BitCode append(BitCode other) const {
+    if (other.length == MAX_LENGTH) { return other; }
+    return {(bits << other.length) | other.bits, static_cast<uint8_t>(length + other.length)};
+  }
+  /**
+   * @return bit on index, 0 being the first bit of code
+   */
+  [[nodiscard]] constexpr bool operator[](std::size_t index) const { return (bits >> (length - 1 - index)) & 1; }
+
+  [[nodiscard]] constexpr std::size_t size() const { return length; }
+  [[nodiscard]] constexpr bool empty() const { return length == 0; }
+
+  constexpr bool operator==(const BitCode &rhs) const = default;
+};
+static_assert(std::is_trivially_copyable_v<BitCode>);
+
+/**
+ * Conversion of T to BitCode, which is its bit representation in memory order.
  */
 template<typename T>
-std::vector<bool> typeToBits(const T &value) {
-  auto result = std::vector<bool>{};
-  result.reserve(sizeof(T) * 8);
+BitCode typeToBits(const T &value) requires(sizeof(T) * 8 <= BitCode::MAX_LENGTH) {
+  auto result = BitCode{};
   const auto rawDataPtr = reinterpret_cast<const uint8_t *>(&value);
-  for (std::size_t i = 0; i < sizeof(T); ++i) {
-    const auto byte = rawDataPtr[i];
-    for (int j = 7; j >= 0; --j) { result.template emplace_back(byte & (1 << j)); }
-  }
+  for (std::size_t i = 0; i < sizeof(T); ++i) { result = result.append(BitCode{rawDataPtr[i], 8}); }
   return result;
 }
 
+/**
+ * Conversion of T to BitCode of given length. Bit representation is either cut from the start or padded with zeros.
+ */
 template<typename T>
-std::vector<bool> typeToBits(const T &value, std::size_t bitLength) {
-  const auto padding = bitLength >= sizeof(T) * 8 ? bitLength - sizeof(T) * 8 : 0;
-  auto result = std::vector<bool>(padding, false);
-  if (bitLength < sizeof(T) * 8) {
-    std::ranges::copy_n(typeToBits(value).begin() + (sizeof(T) * 8 - bitLength), bitLength, std::back_inserter(result));
-  } else {
-    std::ranges::copy(typeToBits(value), std::back_inserter(result));
-  }
+BitCode typeToBits(const T &value, std::size_t bitLength) {
+  assert(bitLength <= BitCode::MAX_LENGTH);
+  auto result = typeToBits(value);
+  if (bitLength < result.length) { result.bits &= (uint64_t{1} << bitLength) - 1; }
+  result.length = static_cast<uint8_t>(bitLength);
   return result;
 }
 
@@ -146,13 +181,15 @@ inline void writeToFile(const std::filesystem::path &path, const std::string &te
   ostream << text;
 }
 
-template <std::integral T>
-T binToIntegral(const std::vector<bool> &bin) {
-  auto result = T{};
-  for (std::size_t i = 0; i < bin.size(); ++i) {
-    result += bin[i] ? std::pow(2, 8 - i) : 0;
+/**
+ * Conversion of native word to big endian, which is the bit order of all encoded streams.
+ */
+constexpr uint64_t toBigEndian(uint64_t value) {
+  if constexpr (std::endian::native == std::endian::little) {
+    return __builtin_bswap64(value);
+  } else {
+    return value;
   }
-  return result;
 }
 
 auto countBitsPerCharacter(std::integral auto origSize, std::integral auto newSize) {